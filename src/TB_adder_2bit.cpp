@@ -67,13 +67,17 @@ int main(int argc, char **argv) {
   lbcrypto::BINFHE_PARAMSET set(lbcrypto::STD128Q_LMKCDEY);
   lbcrypto::BINFHE_METHOD method(lbcrypto::LMKCDEY);
   bool verbose(false);
+  CircuitOptions opts;
 
   // note parse inputs has several parameters we do not use in this simple case.
 
-  bool dummy1, dummy2, dummy3;
-  unsigned int dummy4;
-  parse_inputs(argc, argv, &dummy1, &dummy2, &dummy3, &verbose, &set, &method,
-               &dummy4, &num_test_loops);
+  bool dummy1, dummy2;
+  unsigned int dummy3;
+  parse_inputs(argc, argv, &dummy1, &dummy2, &verbose, &set, &method, &dummy3,
+               &num_test_loops, &opts);
+
+  // one key set for all cases, loaded from the key store if given
+  KeySetPtr keys = GetKeySet(opts.keyDir, set, method, opts.lutInputs);
 
   std::cout << "Test bench for 2bit adder" << std::endl;
 
@@ -91,7 +95,7 @@ int main(int argc, char **argv) {
   insureFileExists(outputFname);
 
   bool passed;
-  passed = test_adder(outputFname, num_test_loops, set, method);
+  passed = test_adder(outputFname, num_test_loops, keys, opts);
   all_passed = all_passed && passed;
 
   std::cout << "===========================" << std::endl;
@@ -70,7 +70,6 @@ int main(int argc, char **argv) {
   std::cout << "Test bench for adders" << std::endl;
 
   bool analyze_flag = false;
-  bool gen_fan_flag = false;
   bool assemble_flag = true && analyze_flag; // cant assemble without analysis
 
   unsigned int n_cases = 2;
@@ -79,9 +78,13 @@ int main(int argc, char **argv) {
   lbcrypto::BINFHE_PARAMSET set(lbcrypto::STD128Q_LMKCDEY);
   lbcrypto::BINFHE_METHOD method(lbcrypto::LMKCDEY);
   bool verbose(false);
+  CircuitOptions opts;
 
-  parse_inputs(argc, argv, &assemble_flag, &gen_fan_flag, &analyze_flag,
-               &verbose, &set, &method, &n_cases, &num_test_loops);
+  parse_inputs(argc, argv, &assemble_flag, &analyze_flag, &verbose, &set,
+               &method, &n_cases, &num_test_loops, &opts);
+
+  // one key set for all cases, loaded from the key store if given
+  KeySetPtr keys = GetKeySet(opts.keyDir, set, method, opts.lutInputs);
 
   std::string inputFname;
   std::string outputFname;
@@ -118,7 +121,7 @@ int main(int argc, char **argv) {
     outputFname = dirPath + "/" + outputFname;
     if (analyze_flag) {
       std::cout << "analyzing " << inputFname << std::endl;
-      analysis_result = analyze_bristol(inputFname, gen_fan_flag, new_flag);
+      analysis_result = analyze_bristol(inputFname, new_flag);
     }
 
     if (assemble_flag) {
@@ -134,7 +137,7 @@ int main(int argc, char **argv) {
 
     insureFileExists(outputFname);
 
-    passed = test_adder(outputFname, num_test_loops, set, method);
+    passed = test_adder(outputFname, num_test_loops, keys, opts);
     all_passed = all_passed && passed;
 
     std::cout << "===========================" << std::endl;
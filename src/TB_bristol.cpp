@@ -0,0 +1,277 @@
+// @file TB_bristol.cpp -- new format Bristol circuits loaded directly
+//==================================================================================
+// BSD 2-Clause License
+//
+// Copyright (c) 2014-2022, NJIT, Duality Technologies Inc. and other
+// contributors
+//
+// All rights reserved.
+//
+// Author TPOC: contact@openfhe.org
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//==================================================================================
+//
+// Test Bench for "Bristol fashion" (new format) circuits provided at
+// <https://homes.esat.kuleuven.be/~nsmart/MPC/>. These cannot go through
+// the assembler, so the circuits are loaded straight from the Bristol
+// file with Circuit::ReadBristol(). Arithmetic and floating point cases
+// are checked on random inputs against native C++, the crypto cases
+// against published test vectors.
+//
+// Every bus is little endian: bit i of a bus is bit i of the number. The
+// crypto circuits read their byte strings as one big endian number.
+//
+
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "binfhecontext.h"
+
+#include "circuit.h"
+#include "utils.h"
+
+// a 64 bit bus
+std::vector<unsigned int> bus64(uint64_t x) {
+  std::vector<unsigned int> bus(64);
+  for (unsigned int ix = 0; ix < 64; ix++) {
+    bus[ix] = (x >> ix) & 1;
+  }
+  return bus;
+}
+
+// a bus holding a byte string given in hex, as one big endian number
+std::vector<unsigned int> busHex(std::string hex) {
+  size_t n_bytes = hex.size() / 2;
+  std::vector<unsigned int> bus(8 * n_bytes);
+  for (size_t byte = 0; byte < n_bytes; byte++) {
+    unsigned int value = std::stoul(hex.substr(2 * byte, 2), nullptr, 16);
+    for (unsigned int bit = 0; bit < 8; bit++) {
+      bus[8 * (n_bytes - 1 - byte) + bit] = (value >> bit) & 1;
+    }
+  }
+  return bus;
+}
+
+uint64_t random64(void) {
+  return (uint64_t(rand()) << 62) ^ (uint64_t(rand()) << 31) ^ rand();
+}
+
+double randomDouble(void) {
+  return (rand() / double(RAND_MAX) - 0.5) * 2000.0;
+}
+
+uint64_t doubleBits(double d) {
+  uint64_t x;
+  memcpy(&x, &d, sizeof x);
+  return x;
+}
+
+int main(int argc, char **argv) {
+  std::cout << "Test bench for new format Bristol circuits" << std::endl;
+
+  bool analyze_flag = false;
+  bool assemble_flag = false;
+
+  unsigned int n_cases = 8; // the crypto cases are large, add them with -c
+  unsigned int num_test_loops = 4;
+
+  lbcrypto::BINFHE_PARAMSET set(lbcrypto::STD128Q_LMKCDEY);
+  lbcrypto::BINFHE_METHOD method(lbcrypto::LMKCDEY);
+  bool verbose(false);
+  CircuitOptions opts;
+
+  parse_inputs(argc, argv, &assemble_flag, &analyze_flag, &verbose, &set,
+               &method, &n_cases, &num_test_loops, &opts);
+
+  // one key set for all cases, loaded from the key store if given
+  KeySetPtr keys = GetKeySet(opts.keyDir, set, method, opts.lutInputs);
+
+  bool all_passed = true;
+  for (unsigned int i = 0; i < n_cases; i++) {
+    std::string inputFname;
+    std::vector<Inputs> inputs;
+    std::vector<Outputs> expected;
+    Inputs constants; // input buses known to be constant, empty if none
+    srand(i); // set the random number generator to a known seed
+    switch (i) {
+    case 0:
+      inputFname = "arith/adder64.txt";
+      for (unsigned int t = 0; t < num_test_loops; t++) {
+        uint64_t a = random64(), b = random64();
+        inputs.push_back({bus64(a), bus64(b)});
+        expected.push_back({bus64(a + b)});
+      }
+      break;
+    case 1:
+      inputFname = "arith/sub64.txt";
+      for (unsigned int t = 0; t < num_test_loops; t++) {
+        uint64_t a = random64(), b = random64();
+        inputs.push_back({bus64(a), bus64(b)});
+        expected.push_back({bus64(a - b)});
+      }
+      break;
+    case 2:
+      inputFname = "arith/mult64.txt";
+      for (unsigned int t = 0; t < num_test_loops; t++) {
+        uint64_t a = random64(), b = random64();
+        inputs.push_back({bus64(a), bus64(b)});
+        expected.push_back({bus64(a * b)});
+      }
+      break;
+    case 3:
+      inputFname = "arith/neg64.txt";
+      for (unsigned int t = 0; t < num_test_loops; t++) {
+        uint64_t a = random64();
+        inputs.push_back({bus64(a)});
+        expected.push_back({bus64(-a)});
+      }
+      break;
+    case 4:
+      inputFname = "arith/zero_equal.txt";
+      for (unsigned int t = 0; t < num_test_loops; t++) {
+        uint64_t a = (t % 2) ? random64() : 0;
+        inputs.push_back({bus64(a)});
+        expected.push_back({{a == 0}});
+      }
+      break;
+    case 5:
+      inputFname = "arith/udivide64.txt";
+      for (unsigned int t = 0; t < num_test_loops; t++) {
+        uint64_t a = random64(), b = random64() >> (rand() % 64);
+        b = b ? b : 1;
+        inputs.push_back({bus64(a), bus64(b)});
+        expected.push_back({bus64(a / b)});
+      }
+      break;
+    case 6:
+      inputFname = "fp/FP-add.txt";
+      for (unsigned int t = 0; t < num_test_loops; t++) {
+        double a = randomDouble(), b = randomDouble();
+        inputs.push_back({bus64(doubleBits(a)), bus64(doubleBits(b))});
+        expected.push_back({bus64(doubleBits(a + b))});
+      }
+      break;
+    case 7:
+      inputFname = "fp/FP-mul.txt";
+      for (unsigned int t = 0; t < num_test_loops; t++) {
+        double a = randomDouble(), b = randomDouble();
+        inputs.push_back({bus64(doubleBits(a)), bus64(doubleBits(b))});
+        expected.push_back({bus64(doubleBits(a * b))});
+      }
+      break;
+    case 8:
+      // FIPS-197 appendix C.1
+      inputFname = "crypto/aes_128.txt";
+      inputs.push_back({busHex("000102030405060708090a0b0c0d0e0f"),
+                        busHex("00112233445566778899aabbccddeeff")});
+      expected.push_back({busHex("69c4e0d86a7b0430d8cdb78070b4c55a")});
+      break;
+    case 9: {
+      // compression function only: one padded block and the chaining value
+      inputFname = "crypto/sha256.txt";
+      std::string iv = "6a09e667bb67ae853c6ef372a54ff53a"
+                       "510e527f9b05688c1f83d9ab5be0cd19";
+      inputs.push_back({busHex(std::string(128, '0')), busHex(iv)});
+      expected.push_back({busHex("da5698be17b9b46962335799779fbeca"
+                                 "8ce5d491c0d26243bafef9ea1837a9d8")});
+      // "abc"
+      inputs.push_back({busHex("6162638" + std::string(119, '0') + "18"),
+                        busHex(iv)});
+      expected.push_back({busHex("ba7816bf8f01cfea414140de5dae2223"
+                                 "b00361a396177a9cb410ff61f20015ad")});
+      // both start from the IV, with -o it is folded into the circuit
+      constants = {{}, busHex(iv)};
+      break;
+    }
+    case 10:
+      // Keccak-f[1600] of the all zero state, only the first lane (the
+      // top 64 bits of the bus) is checked
+      inputFname = "crypto/Keccak_f.txt";
+      inputs.push_back({std::vector<unsigned int>(1600, 0)});
+      expected.push_back({busHex("e7dde140798f25f1")});
+      break;
+    default:
+      std::cout << "bad case number:" << i << std::endl;
+      exit(-1);
+    }
+    inputFname = "examples/new_bristol_ckts/" + inputFname;
+    insureFileExists(inputFname);
+
+    Circuit circ(keys);
+    circ.setOptions(opts);
+    for (unsigned int bus = 0; bus < constants.size(); bus++) {
+      for (unsigned int bit = 0; bit < constants[bus].size(); bit++) {
+        circ.setConstantInput(bus, bit, constants[bus][bit]);
+      }
+    }
+    bool new_flag(true);
+    circ.ReadBristol(inputFname, new_flag);
+
+    auto check = [&](const Outputs &got, const Outputs &want) {
+      if (inputFname.find("Keccak") != std::string::npos) {
+        const auto &bus = got[0];
+        return std::vector<unsigned int>(bus.end() - 64, bus.end()) ==
+               want[0];
+      }
+      return got == want;
+    };
+
+    unsigned int n_p_passed = 0;
+    auto plain = circ.EvaluatePlaintext(inputs);
+    for (size_t t = 0; t < inputs.size(); t++) {
+      n_p_passed += check(plain[t], expected[t]);
+    }
+    unsigned int n_e_passed = 0;
+    for (size_t t = 0; t < inputs.size(); t++) {
+      circ.Reset();
+      circ.setEncrypted(true);
+      circ.SetInput(inputs[t]);
+      n_e_passed += check(circ.Clock(), expected[t]);
+    }
+
+    std::cout << "# tests total: " << inputs.size() << std::endl;
+    std::cout << "# passed plaintext: " << n_p_passed << std::endl;
+    std::cout << "# passed encrypted: " << n_e_passed << std::endl;
+    bool passed = (n_p_passed == inputs.size()) &&
+                  (n_e_passed == inputs.size());
+    all_passed = all_passed && passed;
+    std::cout << "===========================" << std::endl;
+    std::cout << inputFname << " ";
+    if (passed) {
+      std::cout << "passes" << std::endl;
+    } else {
+      std::cout << "fails" << std::endl;
+    }
+  } // loop over case i
+  std::cout << "===========================" << std::endl;
+  if (all_passed) {
+    std::cout << "All Bristol cases passed" << std::endl;
+  } else {
+    std::cout << "Some Bristol cases failed" << std::endl;
+  }
+  std::cout << "===========================" << std::endl;
+}
@@ -0,0 +1,204 @@
+// @file TB_concurrent.cpp -- concurrent circuits sharing one key set
+//==================================================================================
+// BSD 2-Clause License
+//
+// Copyright (c) 2014-2022, NJIT, Duality Technologies Inc. and other
+// contributors
+//
+// All rights reserved.
+//
+// Author TPOC: contact@openfhe.org
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//==================================================================================
+//
+//
+// Test Bench to evaluate several different circuits at the same time
+// under one shared crypto context and key set, as a service holding
+// many circuits would. The circuits are first run one after the other,
+// each using all OMP threads, and then all at once, each on its own
+// thread with an equal share of the OMP threads. Both runs check their
+// results and the wall clock time of each is reported.
+//
+// Known Issues:
+//   the output of the concurrent circuits is interleaved
+//
+
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "binfhecontext.h"
+
+#include "analyze.h"
+#include "assemble.h"
+#include "test_adder.h"
+#include "test_comparator.h"
+#include "test_multiplier.h"
+#include "utils.h"
+
+// test function shared by all circuit cases
+using TestFunction = bool (*)(std::string, unsigned int, KeySetPtr,
+                              const CircuitOptions &);
+
+int main(int argc, char **argv) {
+  std::cout << "Test bench for concurrent circuits" << std::endl;
+
+  bool analyze_flag = false;
+  bool assemble_flag = true && analyze_flag; // cant assemble without analysis
+
+  unsigned int n_cases = 3;
+  unsigned int num_test_loops = 10;
+
+  lbcrypto::BINFHE_PARAMSET set(lbcrypto::STD128Q_LMKCDEY);
+  lbcrypto::BINFHE_METHOD method(lbcrypto::LMKCDEY);
+  bool verbose(false);
+  CircuitOptions opts;
+
+  parse_inputs(argc, argv, &assemble_flag, &analyze_flag, &verbose, &set,
+               &method, &n_cases, &num_test_loops, &opts);
+
+  // one key set shared by every circuit
+  KeySetPtr keys = GetKeySet(opts.keyDir, set, method, opts.lutInputs);
+
+  uint64_t max_depth = 0; // max depth supported before bootstrap needed
+  bool new_flag(false);
+
+  std::vector<std::string> outputFnames;
+  std::vector<TestFunction> tests;
+  for (unsigned int i = 0; i < n_cases; i++) {
+    std::string dirPath = "examples/old_bristol_ckts/arith";
+    std::string inputFname;
+    std::string outputFname;
+    TestFunction test;
+    switch (i) {
+    case 0:
+      inputFname = "adder_64bit.txt";
+      outputFname = "adder_64bit_";
+      test = test_adder;
+      break;
+    case 1:
+      inputFname = "comparator_32bit_unsigned_lt.txt";
+      outputFname = "comparator_32bit_unsigned_lt_";
+      test = test_comparator;
+      break;
+    case 2:
+      inputFname = "mult_32x32.txt";
+      outputFname = "mult_32x32_";
+      test = test_multiplier;
+      break;
+    default:
+      std::cout << "bad case number:" << i << std::endl;
+      exit(-1);
+    }
+    if (max_depth == 0) {
+      outputFname = outputFname + "FHE.out";
+    } else {
+      outputFname = outputFname + std::to_string(max_depth) + ".out";
+    }
+
+    Analysis analysis_result;
+    // analyze the circuit file for the case
+    inputFname = dirPath + "/" + inputFname;
+    outputFname = dirPath + "/" + outputFname;
+    if (analyze_flag) {
+      std::cout << "analyzing " << inputFname << std::endl;
+      analysis_result = analyze_bristol(inputFname, new_flag);
+    }
+
+    if (assemble_flag) {
+      // generate assembler
+      bool debug_flag = true; // annotate assembler output
+
+      //  now assemble note this writes out a new version of .out
+
+      std::cout << "assembling " << inputFname << std::endl;
+      assemble_bristol(analysis_result, max_depth, debug_flag);
+    }
+
+    insureFileExists(outputFname);
+    outputFnames.push_back(outputFname);
+    tests.push_back(test);
+  } // loop over case i
+
+  int n_proc = omp_get_max_threads();
+  // char not bool, so each thread can write its own element safely
+  std::vector<char> passed(n_cases, false);
+
+  // run the circuits one after the other, each with all threads
+  TIC(auto t_sequential);
+  for (unsigned int i = 0; i < n_cases; i++) {
+    passed[i] = tests[i](outputFnames[i], num_test_loops, keys, opts);
+  }
+  auto sequential_time = TOC_MS(t_sequential);
+  bool all_passed = std::all_of(passed.begin(), passed.end(),
+                                [](char p) { return p; });
+
+  // run all circuits at once, first with an equal share of the threads
+  // each, then with all threads each, leaving the OS to share the cores
+  std::vector<int> threads_per_circuit = {std::max(1, n_proc / int(n_cases)),
+                                          n_proc};
+  std::vector<uint64_t> concurrent_time;
+  for (auto n_threads : threads_per_circuit) {
+    std::fill(passed.begin(), passed.end(), false);
+    TIC(auto t_concurrent);
+    std::vector<std::thread> workers;
+    for (unsigned int i = 0; i < n_cases; i++) {
+      workers.emplace_back([&, i] {
+        omp_set_num_threads(n_threads);
+        passed[i] = tests[i](outputFnames[i], num_test_loops, keys, opts);
+      });
+    }
+    for (auto &w : workers) {
+      w.join();
+    }
+    concurrent_time.push_back(std::max(uint64_t(TOC_MS(t_concurrent)),
+                                       uint64_t(1)));
+    all_passed = all_passed && std::all_of(passed.begin(), passed.end(),
+                                           [](char p) { return p; });
+  }
+
+  if (sequential_time == 0)
+    sequential_time = 1;
+  std::cout << "===========================" << std::endl;
+  std::cout << "### Sequential time " << sequential_time << " msec for "
+            << n_cases << " circuits, " << n_proc << " threads each"
+            << std::endl;
+  for (size_t ix = 0; ix < concurrent_time.size(); ix++) {
+    std::cout << "### Concurrent time " << concurrent_time[ix]
+              << " msec for " << n_cases << " circuits, "
+              << threads_per_circuit[ix] << " threads each, speedup "
+              << float(sequential_time) / float(concurrent_time[ix])
+              << std::endl;
+  }
+  std::cout << "===========================" << std::endl;
+  if (all_passed) {
+    std::cout << "All Concurrent cases passed" << std::endl;
+  } else {
+    std::cout << "Some Concurrent cases failed" << std::endl;
+  }
+  std::cout << "===========================" << std::endl;
+}
@@ -0,0 +1,222 @@
+// @file TB_load.cpp -- startup time of text versus binary circuits
+//==================================================================================
+// BSD 2-Clause License
+//
+// Copyright (c) 2014-2022, NJIT, Duality Technologies Inc. and other
+// contributors
+//
+// All rights reserved.
+//
+// Author TPOC: contact@openfhe.org
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//==================================================================================
+//
+// Test Bench comparing the time to load a large circuit from its
+// Bristol text file with the time to map the binary compiled circuit
+// saved from it. Both copies are evaluated on the same random inputs and
+// must agree, in plaintext and encrypted.
+//
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "binfhecontext.h"
+
+#include "circuit.h"
+#include "rewrite.h"
+#include "utils.h"
+
+// NOT gates left in a circuit
+size_t count_nots(const CompiledCircuit &ckt) {
+  size_t n = 0;
+  for (const auto &g : ckt.allGates) {
+    n += (g.op == GateEnum::NOT);
+  }
+  return n;
+}
+
+// random input vectors shaped like the inputs of the circuit
+std::vector<Inputs> random_inputs(const CompiledCircuit &ckt,
+                                  unsigned int n) {
+  Inputs shape;
+  for (const auto &g : ckt.inputGates) {
+    if (g.ioBus >= shape.size()) {
+      shape.resize(g.ioBus + 1);
+    }
+    if (g.ioBit >= shape[g.ioBus].size()) {
+      shape[g.ioBus].resize(g.ioBit + 1);
+    }
+  }
+  std::vector<Inputs> batch(n, shape);
+  srand(1); // set the random number generator to a known seed
+  for (auto &in : batch) {
+    for (auto &bus : in) {
+      for (auto &bit : bus) {
+        bit = rand() % 2;
+      }
+    }
+  }
+  return batch;
+}
+
+double msec_since(std::chrono::steady_clock::time_point t) {
+  return std::chrono::duration<double, std::milli>(
+             std::chrono::steady_clock::now() - t)
+      .count();
+}
+
+int main(int argc, char **argv) {
+  std::cout << "Test bench for loading binary compiled circuits" << std::endl;
+
+  bool analyze_flag = false;
+  bool assemble_flag = false;
+
+  unsigned int n_cases = 5;
+  unsigned int num_test_loops = 1;
+
+  lbcrypto::BINFHE_PARAMSET set(lbcrypto::STD128Q_LMKCDEY);
+  lbcrypto::BINFHE_METHOD method(lbcrypto::LMKCDEY);
+  bool verbose(false);
+  CircuitOptions opts;
+
+  parse_inputs(argc, argv, &assemble_flag, &analyze_flag, &verbose, &set,
+               &method, &n_cases, &num_test_loops, &opts);
+
+  // one key set for all cases, loaded from the key store if given
+  KeySetPtr keys = GetKeySet(opts.keyDir, set, method, opts.lutInputs);
+
+  bool all_passed = true;
+  for (unsigned int i = 0; i < n_cases; i++) {
+    std::string inputFname;
+    bool new_flag(true);
+    CircuitOptions copts = opts;
+    KeySetPtr ckeys = keys;
+    std::string suffix = "_FHE.bin";
+    switch (i) {
+    case 0:
+      inputFname = "examples/old_bristol_ckts/crypto/sha-256.txt";
+      new_flag = false;
+      break;
+    case 1:
+      inputFname = "examples/new_bristol_ckts/crypto/Keccak_f.txt";
+      break;
+    case 2:
+      inputFname = "examples/new_bristol_ckts/fp/FP-sqrt.txt";
+      break;
+    case 3:
+      // saved after every rewrite, read back with the same options. the
+      // flags in the file keep the passes from running again, which LUT
+      // gates would not survive
+      inputFname = "examples/new_bristol_ckts/crypto/Keccak_f.txt";
+      copts.optimize = true;
+      copts.rebalance = true;
+      copts.lutInputs = 3;
+      suffix = "_LUT_FHE.bin";
+      if (opts.lutInputs != copts.lutInputs) {
+        ckeys = GetKeySet(opts.keyDir, set, method, copts.lutInputs);
+      }
+      break;
+    case 4:
+      // the NOTs the tech map adds for inverted leaves must still be
+      // pushed after an optimized circuit was mapped
+      inputFname = "examples/new_bristol_ckts/crypto/aes_128.txt";
+      copts.optimize = true;
+      copts.techMap = true;
+      copts.pushNots = true;
+      suffix = "_TECH_FHE.bin";
+      break;
+    default:
+      std::cout << "bad case number:" << i << std::endl;
+      exit(-1);
+    }
+    insureFileExists(inputFname);
+    std::string binFname =
+        inputFname.substr(0, inputFname.find_last_of('.')) + suffix;
+
+    Circuit text(ckeys);
+    text.setOptions(copts);
+    auto t_text = std::chrono::steady_clock::now();
+    text.ReadBristol(inputFname, new_flag);
+    double text_ms = msec_since(t_text);
+    text.SaveCompiled(binFname);
+
+    Circuit bin(ckeys);
+    bin.setOptions(copts);
+    auto t_bin = std::chrono::steady_clock::now();
+    bin.ReadCompiled(binFname);
+    double bin_ms = msec_since(t_bin);
+
+    auto inputs = random_inputs(*text.getCompiled(), num_test_loops);
+    auto expected = text.EvaluatePlaintext(inputs);
+    unsigned int n_p_passed = 0;
+    auto plain = bin.EvaluatePlaintext(inputs);
+    for (size_t t = 0; t < inputs.size(); t++) {
+      n_p_passed += (plain[t] == expected[t]);
+    }
+    unsigned int n_e_passed = 0;
+    for (size_t t = 0; t < inputs.size(); t++) {
+      bin.Reset();
+      bin.setEncrypted(true);
+      bin.SetInput(inputs[t]);
+      n_e_passed += (bin.Clock() == expected[t]);
+    }
+
+    // nothing is left for another pass to fold
+    bool nots_pushed = true;
+    if (copts.pushNots) {
+      size_t n_nots = count_nots(*bin.getCompiled());
+      size_t n_left = count_nots(*PushInversions(*bin.getCompiled()));
+      std::cout << "# NOT gates: " << n_nots << ", after another push "
+                << n_left << std::endl;
+      nots_pushed = (n_nots == n_left);
+    }
+
+    std::cout << "# tests total: " << inputs.size() << std::endl;
+    std::cout << "# passed plaintext: " << n_p_passed << std::endl;
+    std::cout << "# passed encrypted: " << n_e_passed << std::endl;
+    std::cout << "### " << inputFname << " text load " << text_ms
+              << " msec, binary load " << bin_ms << " msec ("
+              << text_ms / bin_ms << "x)" << std::endl;
+    bool passed = (n_p_passed == inputs.size()) &&
+                  (n_e_passed == inputs.size()) && nots_pushed;
+    all_passed = all_passed && passed;
+    std::cout << "===========================" << std::endl;
+    std::cout << binFname << " ";
+    if (passed) {
+      std::cout << "passes" << std::endl;
+    } else {
+      std::cout << "fails" << std::endl;
+    }
+  } // loop over case i
+  std::cout << "===========================" << std::endl;
+  if (all_passed) {
+    std::cout << "All Load cases passed" << std::endl;
+  } else {
+    std::cout << "Some Load cases failed" << std::endl;
+  }
+  std::cout << "===========================" << std::endl;
+}
@@ -74,7 +74,6 @@ int main(int argc, char **argv) {
   std::cout << "Test bench for md5 " << std::endl;
 
   bool analyze_flag = false;
-  bool gen_fan_flag = false;
   bool assemble_flag = true && analyze_flag; // cant assemble without analysis
 
   unsigned int n_cases = 1;
@@ -83,9 +82,13 @@ int main(int argc, char **argv) {
   lbcrypto::BINFHE_PARAMSET set(lbcrypto::STD128Q_LMKCDEY);
   lbcrypto::BINFHE_METHOD method(lbcrypto::LMKCDEY);
   bool verbose(false);
+  CircuitOptions opts;
 
-  parse_inputs(argc, argv, &assemble_flag, &gen_fan_flag, &analyze_flag,
-               &verbose, &set, &method, &n_cases, &num_test_loops);
+  parse_inputs(argc, argv, &assemble_flag, &analyze_flag, &verbose, &set,
+               &method, &n_cases, &num_test_loops, &opts);
+
+  // one key set for all cases, loaded from the key store if given
+  KeySetPtr keys = GetKeySet(opts.keyDir, set, method, opts.lutInputs);
   // note n_cases is ignored
   if (n_cases != 1) {
     std::cout << "Note n_cases is ignored for this Test Bench" << std::endl;
@@ -115,7 +118,7 @@ int main(int argc, char **argv) {
   outputFname = dirPath + "/" + outputFname;
   if (analyze_flag) {
     std::cout << "analyzing " << inputFname << std::endl;
-    analysis_result = analyze_bristol(inputFname, gen_fan_flag, new_flag);
+    analysis_result = analyze_bristol(inputFname, new_flag);
   }
 
   if (assemble_flag) {
@@ -131,7 +134,7 @@ int main(int argc, char **argv) {
   insureFileExists(outputFname);
 
   bool passed;
-  passed = test_md5(outputFname, num_test_loops, set, method);
+  passed = test_md5(outputFname, num_test_loops, keys, opts);
 
   std::cout << "===========================" << std::endl;
   std::cout << outputFname << " ";
@@ -0,0 +1,212 @@
+// @file TB_stream.cpp -- pipelined evaluation of a stream of requests
+//==================================================================================
+// BSD 2-Clause License
+//
+// Copyright (c) 2014-2022, NJIT, Duality Technologies Inc. and other
+// contributors
+//
+// All rights reserved.
+//
+// Author TPOC: contact@openfhe.org
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//==================================================================================
+//
+//
+// Test Bench to evaluate a stream of random requests on one circuit,
+// first one Clock() after the other and then pipelined through a
+// CircuitStream, where several requests are in flight at once. Every
+// encrypted output is checked against the bit sliced plaintext result,
+// and the throughput and latency of both runs are reported.
+//
+
+#include <algorithm>
+#include <chrono>
+#include <future>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "binfhecontext.h"
+
+#include "analyze.h"
+#include "assemble.h"
+#include "stream.h"
+#include "utils.h"
+
+// random input vectors shaped like the inputs of the circuit
+std::vector<Inputs> random_inputs(const CompiledCircuit &ckt,
+                                  unsigned int n) {
+  Inputs shape;
+  for (const auto &g : ckt.inputGates) {
+    if (g.ioBus >= shape.size()) {
+      shape.resize(g.ioBus + 1);
+    }
+    if (g.ioBit >= shape[g.ioBus].size()) {
+      shape[g.ioBus].resize(g.ioBit + 1);
+    }
+  }
+  std::vector<Inputs> batch(n, shape);
+  srand(1); // set the random number generator to a known seed
+  for (auto &in : batch) {
+    for (auto &bus : in) {
+      for (auto &bit : bus) {
+        bit = rand() % 2;
+      }
+    }
+  }
+  return batch;
+}
+
+int main(int argc, char **argv) {
+  std::cout << "Test bench for streams of requests" << std::endl;
+
+  bool analyze_flag = false;
+  bool assemble_flag = true && analyze_flag; // cant assemble without analysis
+
+  unsigned int n_cases = 2;
+  unsigned int num_test_loops = 16;
+
+  lbcrypto::BINFHE_PARAMSET set(lbcrypto::STD128Q_LMKCDEY);
+  lbcrypto::BINFHE_METHOD method(lbcrypto::LMKCDEY);
+  bool verbose(false);
+  CircuitOptions opts;
+
+  parse_inputs(argc, argv, &assemble_flag, &analyze_flag, &verbose, &set,
+               &method, &n_cases, &num_test_loops, &opts);
+
+  // one key set for all cases, loaded from the key store if given
+  KeySetPtr keys = GetKeySet(opts.keyDir, set, method, opts.lutInputs);
+
+  uint64_t max_depth = 0; // max depth supported before bootstrap needed
+  bool new_flag(false);
+
+  bool all_passed = true;
+  for (unsigned int i = 0; i < n_cases; i++) {
+    std::string dirPath = "examples/old_bristol_ckts/arith";
+    std::string inputFname;
+    std::string outputFname;
+    switch (i) {
+    case 0:
+      inputFname = "adder_64bit.txt";
+      outputFname = "adder_64bit_";
+      break;
+    case 1:
+      inputFname = "mult_32x32.txt";
+      outputFname = "mult_32x32_";
+      break;
+    default:
+      std::cout << "bad case number:" << i << std::endl;
+      exit(-1);
+    }
+    if (max_depth == 0) {
+      outputFname = outputFname + "FHE.out";
+    } else {
+      outputFname = outputFname + std::to_string(max_depth) + ".out";
+    }
+
+    Analysis analysis_result;
+    // analyze the circuit file for the case
+    inputFname = dirPath + "/" + inputFname;
+    outputFname = dirPath + "/" + outputFname;
+    if (analyze_flag) {
+      std::cout << "analyzing " << inputFname << std::endl;
+      analysis_result = analyze_bristol(inputFname, new_flag);
+    }
+
+    if (assemble_flag) {
+      // generate assembler
+      bool debug_flag = true; // annotate assembler output
+
+      //  now assemble note this writes out a new version of .out
+
+      std::cout << "assembling " << inputFname << std::endl;
+      assemble_bristol(analysis_result, max_depth, debug_flag);
+    }
+
+    insureFileExists(outputFname);
+
+    Circuit circ(keys);
+    circ.setOptions(opts);
+    circ.ReadFile(outputFname);
+    auto requests = random_inputs(*circ.getCompiled(), num_test_loops);
+    auto expected = circ.EvaluatePlaintext(requests);
+
+    // one request after the other
+    unsigned int n_seq_passed = 0;
+    auto t_seq = std::chrono::steady_clock::now();
+    for (unsigned int r = 0; r < num_test_loops; r++) {
+      circ.Reset();
+      circ.setEncrypted(true);
+      circ.SetInput(requests[r]);
+      if (circ.Clock() == expected[r]) {
+        n_seq_passed++;
+      }
+    }
+    double seq_ms = std::chrono::duration<double, std::milli>(
+                        std::chrono::steady_clock::now() - t_seq)
+                        .count();
+
+    // pipelined
+    unsigned int n_stream_passed = 0;
+    {
+      CircuitStream stream(keys, circ.getCompiled());
+      std::vector<std::future<Outputs>> results;
+      for (unsigned int r = 0; r < num_test_loops; r++) {
+        results.push_back(stream.Submit(requests[r]));
+      }
+      for (unsigned int r = 0; r < num_test_loops; r++) {
+        if (results[r].get() == expected[r]) {
+          n_stream_passed++;
+        }
+      }
+      std::cout << "===========================" << std::endl;
+      std::cout << outputFname << std::endl;
+      std::cout << "### Sequential throughput "
+                << num_test_loops / std::max(seq_ms, 1.0) * 1000.0
+                << " requests/sec, latency msec "
+                << seq_ms / num_test_loops << std::endl;
+      stream.Report();
+    }
+    std::cout << "# tests total: " << num_test_loops << std::endl;
+    std::cout << "# passed sequential: " << n_seq_passed << std::endl;
+    std::cout << "# passed stream: " << n_stream_passed << std::endl;
+    bool passed = (n_seq_passed == num_test_loops) &&
+                  (n_stream_passed == num_test_loops);
+    all_passed = all_passed && passed;
+    std::cout << outputFname << " ";
+    if (passed) {
+      std::cout << "passes" << std::endl;
+    } else {
+      std::cout << "fails" << std::endl;
+    }
+  } // loop over case i
+  std::cout << "===========================" << std::endl;
+  if (all_passed) {
+    std::cout << "All Stream cases passed" << std::endl;
+  } else {
+    std::cout << "Some Stream cases failed" << std::endl;
+  }
+  std::cout << "===========================" << std::endl;
+}
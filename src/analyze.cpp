@@ -35,9 +35,64 @@
 #include "analyze.h"
 
 #include <algorithm>
+#include <chrono>
 #include <cstring>
+#include <fcntl.h>
 #include <functional>
 #include <iostream>
+#include <strings.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
+
+// forward scanner over a memory mapped circuit file. numbers and names
+// are read in place, there is no per line buffer so lines can be any
+// length. line breaks are treated like any other blank.
+class BristolScanner {
+public:
+  BristolScanner(const char *begin, size_t size)
+      : p(begin), end(begin + size) {}
+
+  // read the next unsigned integer, false at the end or on a non digit
+  bool next(unsigned int *value) {
+    _SkipBlanks();
+    if ((this->p == this->end) || (*this->p < '0') || (*this->p > '9')) {
+      return false;
+    }
+    unsigned int v = 0;
+    while ((this->p != this->end) && (*this->p >= '0') && (*this->p <= '9')) {
+      v = v * 10 + (*this->p - '0');
+      this->p++;
+    }
+    *value = v;
+    return true;
+  }
+
+  // point at the next token of non blank characters, false at the end
+  bool word(const char **token, size_t *len) {
+    _SkipBlanks();
+    const char *start = this->p;
+    while ((this->p != this->end) && !_IsBlank(*this->p)) {
+      this->p++;
+    }
+    *token = start;
+    *len = this->p - start;
+    return *len > 0;
+  }
+
+private:
+  static bool _IsBlank(char c) {
+    return (c == ' ') || (c == '\n') || (c == '\t') || (c == '\r');
+  }
+  void _SkipBlanks(void) {
+    while ((this->p != this->end) && _IsBlank(*this->p)) {
+      this->p++;
+    }
+  }
+  const char *p;
+  const char *end;
+};
 
 Variable::Variable(void){
 
@@ -53,8 +108,7 @@ Analysis::~Analysis(void){
 
 };
 
-Analysis analyze_bristol(std::string in_fname, bool gen_fan_flag,
-                         bool new_flag) {
+Analysis analyze_bristol(std::string in_fname, bool new_flag) {
   //  Code to analyze a Bristol Fasion circuit file and generate a
   //  processeed variable and function list for further processing
   //  by assemble()
@@ -75,7 +129,6 @@ Analysis analyze_bristol(std::string in_fname, bool gen_fan_flag,
   //
   //  Input
   //    A file to parse.
-  //    gen_fan_flag if true, generate fan_in and fan out statistics
   //  Output
   //    the circuit is preprocessed in to a list of variables and functions by
   //    the analyze() function.
@@ -91,92 +144,93 @@ Analysis analyze_bristol(std::string in_fname, bool gen_fan_flag,
   //    None.
   //
   //
-  // note this file was translated from matlab which uses C file IO
-
-  // //  open the file name
-  FILE *fid = fopen(in_fname.c_str(), "r");
+  // note this file was translated from matlab which used C file IO, the
+  // circuit file is now memory mapped and scanned in place
 
+  // //  map the file, it is parsed in place in one forward scan
+  auto t_parse = std::chrono::steady_clock::now();
   std::cout << "analyzing file " << in_fname << std::endl;
-  if (fid == NULL) {
-    std::cout << "error opening file.. exiting!" << std::endl;
+  int fd = open(in_fname.c_str(), O_RDONLY);
+  struct stat sb;
+  if ((fd < 0) || (fstat(fd, &sb) != 0) || (sb.st_size == 0)) {
+    std::cerr << "error opening file " << in_fname << ".. exiting!"
+              << std::endl;
+    exit(-1);
+  }
+  size_t n_bytes = sb.st_size;
+  void *mapped = mmap(nullptr, n_bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd); // the mapping stays valid
+  if (mapped == MAP_FAILED) {
+    std::cerr << "error mapping file " << in_fname << ".. exiting!"
+              << std::endl;
+    exit(-1);
   }
+  madvise(mapped, n_bytes, MADV_SEQUENTIAL);
+  BristolScanner scan(static_cast<const char *>(mapped), n_bytes);
 
   //  parse the header of the file.
 
   //  the first line for two variables
   std::cout << "Analysis Report for input file " << in_fname << std::endl;
   std::cout << "Parsing circuit i/o" << std::endl;
-  char *remain;
-  char *token;
-  int buffsize = 256;
-  char buff[buffsize];
-
-  remain = fgets(buff, sizeof buff, fid);
-  token = std::strtok(remain, " ");
-  unsigned int n_tot_func;
-  sscanf(token, "%ul", &n_tot_func);
-  token = std::strtok(NULL, " ");
-  unsigned int n_tot_var;
-  sscanf(token, "%d", &n_tot_var);
+  unsigned int n_tot_func(0);
+  unsigned int n_tot_var(0);
+  bool header_ok = scan.next(&n_tot_func) && scan.next(&n_tot_var);
   std::cout << "Total number of nodes: " << n_tot_var << std::endl;
 
-  unsigned int n_inputs;
+  unsigned int n_inputs(0);
   unsigned int n_in1_var(0);
   unsigned int n_in2_var(0);
-  unsigned int n_outputs;
+  unsigned int n_outputs(0);
   unsigned int n_out1_var(0);
+  std::vector<unsigned int> in_bits;
+  std::vector<unsigned int> out_bits;
 
   if (new_flag) {
     std::cout << "new" << std::endl;
-    n_inputs = 2;
-    n_outputs = 1;
-    // new "bristol fashion" files have slightly different header
-
-    // parse the second line for three variables
-    remain = fgets(buff, sizeof buff, fid);
-    token = std::strtok(remain, " ");
-    sscanf(token, "%ul", &n_inputs);
-
-    token = std::strtok(NULL, " ");
-    sscanf(token, "%ul", &n_in1_var);
-
-    token = std::strtok(NULL, " ");
-    sscanf(token, "%d", &n_in2_var);
-
-    remain = fgets(buff, sizeof buff, fid);
-    token = std::strtok(remain, " ");
-
-    sscanf(token, "%d", &n_outputs); // always 1
-
-    token = std::strtok(NULL, " ");
-    sscanf(token, "%d", &n_out1_var);
-
-    // parse the fourth line for a blank
-    char *blank;
-    blank = fgets(buff, sizeof buff, fid);
-    (void)blank;
-
+    // new "bristol fashion" files list the number of input buses and the
+    // width of each, then the same for the outputs. only the first two
+    // inputs and the first output are kept.
+    header_ok = header_ok && scan.next(&n_inputs);
+    for (unsigned int ix = 0; header_ok && (ix < n_inputs); ix++) {
+      unsigned int width = 0;
+      if (!scan.next(&width)) {
+        header_ok = false;
+        break;
+      }
+      in_bits.push_back(width);
+      if (ix == 0) {
+        n_in1_var = width;
+      } else if (ix == 1) {
+        n_in2_var = width;
+      }
+    }
+    header_ok = header_ok && scan.next(&n_outputs);
+    for (unsigned int ix = 0; header_ok && (ix < n_outputs); ix++) {
+      unsigned int width = 0;
+      if (!scan.next(&width)) {
+        header_ok = false;
+        break;
+      }
+      out_bits.push_back(width);
+      if (ix == 0) {
+        n_out1_var = width;
+      }
+    }
   } else {
     std::cout << "old" << std::endl;
     n_inputs = 2;
     n_outputs = 1;
-    // use the old format
-    // parse the second line for three variables
-    remain = fgets(buff, sizeof buff, fid);
-    token = std::strtok(remain, " ");
-
-    sscanf(token, "%ul", &n_in1_var);
-    token = std::strtok(NULL, " ");
-
-    sscanf(token, "%d", &n_in2_var);
-    token = std::strtok(NULL, " ");
-    ;
-
-    sscanf(token, "%d", &n_out1_var);
-    // parse the third line for a blank
-    char *blank;
-    blank = fgets(buff, sizeof buff, fid);
-    (void)blank;
+    // use the old format, the second line has three variables
+    header_ok = header_ok && scan.next(&n_in1_var) &&
+                scan.next(&n_in2_var) && scan.next(&n_out1_var);
+    in_bits = {n_in1_var, n_in2_var};
+    out_bits = {n_out1_var};
+  }
+  if (!header_ok) {
+    std::cerr << "error parsing header of " << in_fname << ".. exiting!"
+              << std::endl;
+    exit(-1);
   }
   std::cout << "number bits input 1 = " << n_in1_var << std::endl;
   if (n_inputs == 2) {
@@ -221,61 +275,49 @@ Analysis analyze_bristol(std::string in_fname, bool gen_fan_flag,
   std::vector<std::vector<unsigned int>> func_out_list(n_tot_func);
 
   for (uint ix = 0; ix < n_tot_func; ix++) {
-    std::vector<unsigned int> inlist;  // list of input nodes
-    std::vector<unsigned int> outlist; // list of output nodes
-
-    //  get # in and out nodes
-    remain = fgets(buff, sizeof buff, fid);
-
-    token = std::strtok(remain, " ");
-    ;
-
+    //  get # in and out nodes, the node lists and the function name
     unsigned int nin;
-    sscanf(token, "%d", &nin);
-    token = std::strtok(NULL, " ");
     unsigned int nout;
-    sscanf(token, "%d", &nout);
-
-    unsigned int tmp;
-    for (uint jj = 0; jj < nin; jj++) { // read list of input nodes
-      token = std::strtok(NULL, " ");
-      sscanf(token, "%d", &tmp);
-      inlist.push_back(tmp);
+    bool line_ok = scan.next(&nin) && scan.next(&nout);
+    std::vector<unsigned int> &inlist = func_in_list[ix]; // input nodes
+    std::vector<unsigned int> &outlist = func_out_list[ix]; // output nodes
+    inlist.resize(line_ok ? nin : 0);
+    outlist.resize(line_ok ? nout : 0);
+    for (auto &node : inlist) { // read list of input nodes
+      line_ok = line_ok && scan.next(&node) && (node < n_tot_var);
+    }
+    for (auto &node : outlist) { // read list of output nodes
+      line_ok = line_ok && scan.next(&node) && (node < n_tot_var);
     }
-    for (uint jj = 0; jj < nout; jj++) { // read list of output nodes
-      token = std::strtok(NULL, " ");
-      sscanf(token, "%d", &tmp);
-      outlist.push_back(tmp);
+    const char *token = nullptr;
+    size_t token_len = 0;
+    line_ok = line_ok && scan.word(&token, &token_len);
+    if (!line_ok) {
+      std::cerr << "parse error on function line " << ix << ".. exiting!"
+                << std::endl;
+      exit(-1);
     }
 
-    token = std::strtok(NULL, " ");
-    ;
-    // inlist = inlist+1; // indicies are starting at 1, node names at 0
-    // outlist = outlist+1; // indicies are starting at 1, node names at 0
-    func_in_list[ix] = inlist;
-    func_out_list[ix] = outlist;
-
-    *std::remove(token, token + strlen(token), '\n') =
-        '\0'; // removes _all_ new lines.
-    std::string str = std::string(token);
-    for (auto &c : str)
-      c = toupper(c); // convert to uppercase
-    // token =  toupper(token); // parse function call
-    if (str == "XOR") {
+    // function names are matched without regard to case
+    auto is = [&](const char *name) {
+      return (strlen(name) == token_len) &&
+             (strncasecmp(token, name, token_len) == 0);
+    };
+    if (is("XOR")) {
       n_xor = n_xor + 1;
       func_call_list[ix] = "XOR"; // function token for xor
-    } else if (str == "AND") {
+    } else if (is("AND")) {
       n_and = n_and + 1;
       func_call_list[ix] = "AND"; // function token for xor
-    } else if (str == "INV") {
+    } else if (is("INV")) {
       n_not = n_not + 1;
       func_call_list[ix] = "NOT"; // function token for inv
-    } else if (str == "EQ") {
+    } else if (is("EQ")) {
       n_eq = n_eq + 1;
       func_call_list[ix] = " EQ"; // function token for inv
       std::cout << "Cannot parse EQ!! yet failing" << std::endl;
       exit(-1);
-    } else if (str == "EQW") {
+    } else if (is("EQW")) {
       n_eqw = n_eqw + 1;
       func_call_list[ix] = "EQW"; // function token for inv
     } else {
@@ -284,21 +326,31 @@ Analysis analyze_bristol(std::string in_fname, bool gen_fan_flag,
 
     // generate high and low water marks for each node
     // low water is first gate that uses the node, high water is last gate
+    // fan out counts the gate inputs a node drives, fan in the gate
+    // outputs that drive it
     for (const auto &jj : inlist) { // (note node name start at 0
       if (var_low_water[jj] == 0) {
         var_low_water[jj] = ix;
       }
       var_high_water[jj] = ix;
+      var_fan_out[jj]++;
     }
     for (const auto &jj : outlist) {
       if (var_low_water[jj] == 0) {
         var_low_water[jj] = ix;
       }
       var_high_water[jj] = ix;
+      var_fan_in[jj]++; // should always be max 1
     }
   } // for ix
 
-  fclose(fid);
+  munmap(mapped, n_bytes);
+  double parse_ms = std::chrono::duration<double, std::milli>(
+                        std::chrono::steady_clock::now() - t_parse)
+                        .count();
+  std::cout << "### Parse time " << parse_ms << " msec for " << n_bytes
+            << " bytes, " << n_bytes / 1.0e3 / std::max(parse_ms, 1.0e-3)
+            << " MB/s" << std::endl;
 
   std::cout << " number of and " << n_and << std::endl;
   std::cout << " number of xor " << n_xor << std::endl;
@@ -306,49 +358,6 @@ Analysis analyze_bristol(std::string in_fname, bool gen_fan_flag,
   std::cout << " number of eq " << n_eq << std::endl;
   std::cout << " number of weqw " << n_eqw << std::endl;
 
-#if 1
-  //  generate fan in and fan out lists
-  if (gen_fan_flag) {
-    std::cout << "parsing fan in, fan out" << std::endl;
-
-    for (uint ix = 0; ix < n_tot_var; ix++) {
-      if (ix % 100 == 0) {
-        std::cout << "\r parsing node " << ix << std::flush;
-      }
-      for (uint jx = 0; jx < n_tot_func; jx++) {
-        auto templist = func_in_list[jx];
-
-        if (1) { // c way
-          for (uint kx = 0; kx < templist.size(); kx++) {
-            if (ix == templist[kx]) {
-              var_fan_out[ix] = var_fan_out[ix] + 1;
-            }
-          }
-        } else { // matlab way
-          // kx = find(templist==ix);
-          // var_fan_out[ix] = var_fan_out[ix] + length(kx);
-        }
-
-        templist = func_out_list[jx];
-        if (1) {
-          for (uint kx = 0; kx < templist.size(); kx++) {
-            if (ix == templist[kx]) {
-              var_fan_in[ix] = var_fan_in[ix] + 1; // should always be max 1
-            }
-          }
-        } else {
-          // kx = find(templist==ix);
-          // var_fan_in[ix] = var_fan_in[ix] + length(kx);
-        }
-      }
-    }
-
-  } else {
-    std::cout << "not parsing fan in, fan out" << std::endl;
-    var_fan_in.clear();
-    var_fan_out.clear();
-  }
-#endif
   Analysis retVal;
 
   retVal.variables.in_fname = in_fname;
@@ -358,21 +367,27 @@ Analysis analyze_bristol(std::string in_fname, bool gen_fan_flag,
   retVal.variables.n_in1_bits = n_in1_var;
   retVal.variables.n_in2_bits = n_in2_var;
   retVal.variables.n_out1_bits = n_out1_var;
-  retVal.variables.high_water = var_high_water;
-  retVal.variables.low_water = var_low_water;
+  retVal.variables.in_bits = std::move(in_bits);
+  retVal.variables.out_bits = std::move(out_bits);
 
   // var_life = var_high_water-var_low_water;
   std::transform(var_high_water.begin(), var_high_water.end(),
                  var_low_water.begin(), var_life.begin(), std::minus<int>());
-  retVal.variables.life = var_life;
 
-  retVal.variables.fan_in = var_fan_in;
-  retVal.variables.fan_out = var_fan_out;
+  unsigned int max_fan_in = 0;
+  unsigned int max_fan_out = 0;
+  unsigned int max_life = 0;
+  if (n_tot_var > 0) {
+    max_fan_in = *max_element(var_fan_in.begin(), var_fan_in.end());
+    max_fan_out = *max_element(var_fan_out.begin(), var_fan_out.end());
+    max_life = *max_element(var_life.begin(), var_life.end());
+  }
 
-  unsigned int max_fan_in = *max_element(var_fan_in.begin(), var_fan_in.end());
-  unsigned int max_fan_out =
-      *max_element(var_fan_out.begin(), var_fan_out.end());
-  unsigned int max_life = *max_element(var_life.begin(), var_life.end());
+  retVal.variables.high_water = std::move(var_high_water);
+  retVal.variables.low_water = std::move(var_low_water);
+  retVal.variables.life = std::move(var_life);
+  retVal.variables.fan_in = std::move(var_fan_in);
+  retVal.variables.fan_out = std::move(var_fan_out);
 
   std::cout << "max fan in (should be 1) = " << max_fan_in << std::endl;
   std::cout << "max fan out = " << max_fan_out << std::endl;
@@ -380,15 +395,15 @@ Analysis analyze_bristol(std::string in_fname, bool gen_fan_flag,
 
   retVal.functions.in_fname = in_fname;
   retVal.functions.n_tot = n_tot_func;
-  retVal.functions.call_list = func_call_list;
-  retVal.functions.in_list = func_in_list;
-  retVal.functions.out_list = func_out_list;
+  retVal.functions.call_list = std::move(func_call_list);
+  retVal.functions.in_list = std::move(func_in_list);
+  retVal.functions.out_list = std::move(func_out_list);
   retVal.functions.n_and = n_and;
   retVal.functions.n_xor = n_xor;
   retVal.functions.n_not = n_not;
   retVal.functions.n_eq = n_eq;
   retVal.functions.n_eqw = n_eq;
-  retVal.functions.names = func_names;
+  retVal.functions.names = std::move(func_names);
 
   return retVal;
 }
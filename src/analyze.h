@@ -48,6 +48,8 @@ public:
   unsigned int n_in1_bits;
   unsigned int n_in2_bits;
   unsigned int n_out1_bits;
+  std::vector<unsigned int> in_bits;  // width of every input bus
+  std::vector<unsigned int> out_bits; // width of every output bus
   std::vector<unsigned int> high_water;
   std::vector<unsigned int> low_water;
   std::vector<unsigned int> life;
@@ -83,7 +85,6 @@ public:
 };
 
 // function declaration
-Analysis analyze_bristol(std::string in_fname, bool gen_fan_flag,
-                         bool new_flag);
+Analysis analyze_bristol(std::string in_fname, bool new_flag);
 
 #endif
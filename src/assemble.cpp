@@ -35,6 +35,7 @@
 #include "assemble.h"
 #include "analyze.h"
 #include <algorithm>
+#include <chrono>
 #include <cstring>
 #include <functional>
 #include <iostream>
@@ -81,6 +82,7 @@ void assemble_bristol(Analysis &analysis, unsigned int max_depth,
   //   none
 
   //  generate an assembly listing for a circuit processed with analyze()
+  auto t_start = std::chrono::steady_clock::now();
 
   Variable v = analysis.variables;
   Function f = analysis.functions;
@@ -115,17 +117,24 @@ void assemble_bristol(Analysis &analysis, unsigned int max_depth,
 
   bool delayed_get_flag = true; // if true, delay get of all registers till end
                                 // otherwise get output right after operation
-                                // map of registers
-  std::vector<bool> reg_active_map(v.n_tot,
-                                   false); // if true then register (i) is
-                                           // currently being used value false
-                                           // = unused value true = used
+
+  // registers are reused: a register is released after the last line
+  // that reads its node (the node's high water mark), and allocated from
+  // a free list. registers beyond reg_counter have never been used.
+  std::vector<unsigned int> free_regs; // released registers, used LIFO
+  free_regs.reserve(v.n_tot);
 
   std::vector<int> reg_node_map(
       v.n_tot, -1); // current circuit node number stored in register (i)
                     // value == node number, -1 == no node.
+  std::vector<int> node_reg_map(
+      v.n_tot, -1); // inverse of reg_node_map, register holding node (i)
+                    // value == register number, -1 == not in a register.
 
   std::vector<int> out_map(v.n_out1_bits, -1); // map of the output registers.
+  std::vector<int> node_out_map(
+      v.n_tot, -1); // inverse of out_map, output number of node (i)
+                    // value == output number, -1 == not an output.
 
   // (i) contains the node number of the ith output;
   std::vector<int> out_reg_map(v.n_out1_bits,
@@ -156,8 +165,8 @@ void assemble_bristol(Analysis &analysis, unsigned int max_depth,
     // load bit ix of register in 1.
     fprintf(fid, "R%d = LOAD(In%d,%d)\n", reg_counter + ADD_IT, 1, ix + ADD_IT);
 
-    reg_active_map[reg_counter] = true;
     reg_node_map[reg_counter] = ix;
+    node_reg_map[ix] = reg_counter;
     tower_counter[reg_counter] = max_depth;
     if (debug_flag) {
       fprintf(fid, "# Assigned node %d to R%d\n",
@@ -172,9 +181,9 @@ void assemble_bristol(Analysis &analysis, unsigned int max_depth,
     // load bit ix of register in 2.
     fprintf(fid, "R%d = LOAD(In%d,%d)\n", reg_counter + ADD_IT, 2, ix + ADD_IT);
 
-    reg_active_map[reg_counter] = true;
     reg_node_map[reg_counter] =
         ix + v.n_in1_bits; // see assumption of register numbering
+    node_reg_map[ix + v.n_in1_bits] = reg_counter;
     tower_counter[reg_counter] = max_depth;
     if (debug_flag) {
       fprintf(fid, "# Assigned node %d to R%d\n",
@@ -189,12 +198,13 @@ void assemble_bristol(Analysis &analysis, unsigned int max_depth,
   for (uint ix = (v.n_tot - v.n_out1_bits); ix < v.n_tot; ix++) {
     out_map[ii] =
         ix; // save node mapping for iith output nodes renumbered to start at 1
+    node_out_map[ix] = ii;
     ii++;
   }
-
-  // keep track of max number of registers in use at each line of the program
-
-  std::vector<unsigned int> active_reg_count(f.n_tot, 0);
+  // output nodes are stored at the end of the program, never release them
+  auto releasable = [&](unsigned int node) {
+    return node < (v.n_tot - v.n_out1_bits);
+  };
 
   // keep track of how many bootstrap operations get called.
   unsigned int boot_counter = 0;
@@ -207,11 +217,50 @@ void assemble_bristol(Analysis &analysis, unsigned int max_depth,
       std::cout << "\r parsed line " << line_ix << std::flush;
     }
     // for each function
-    //  find next free register for storing the output and assign the output
+    /////////////////////////////////////////////////////////////////////////
+    // get the node numbers of the inputs
+
+    const auto &invarlist = f.in_list[line_ix]; // get input node list
+    std::vector<unsigned int> invarnamelist(invarlist.size());
+
+    for (uint jx = 0; jx < invarlist.size(); jx++) {
+      // for each input in the list, find the register_node it is mapped to
+
+      // invarnamelist should be renamed to invar_reg_node_map_index or
+      // something
+      int reg = node_reg_map[invarlist[jx]];
+
+      if (reg >= 0) {
+        invarnamelist[jx] = reg;
+      } else {
+        std::cout
+            << "input register not found in reg_node_map! fatal error, exiting!"
+            << std::endl;
+        exit(-1);
+      }
+    }
+
+    // release the registers of inputs read for the last time on this line,
+    // so the output can reuse one of them
+    for (uint jx = 0; jx < invarlist.size(); jx++) {
+      auto node = invarlist[jx];
+      auto reg = invarnamelist[jx];
+      if ((v.high_water[node] == line_ix) && releasable(node) &&
+          (reg_node_map[reg] == int(node))) { // not already released
+        reg_node_map[reg] = -1;
+        node_reg_map[node] = -1;
+        free_regs.push_back(reg);
+      }
+    }
+
+    //  find a free register for storing the output and assign the output
     // node to it
-    unsigned int jx = 0;
-    while (reg_active_map[jx] != false) {
-      jx++;
+    unsigned int jx;
+    if (!free_regs.empty()) {
+      jx = free_regs.back();
+      free_regs.pop_back();
+    } else {
+      jx = reg_counter++;
       if (jx == v.n_tot) {
         std::cout << "ran out of register storage, fatal error! exiting."
                   << std::endl;
@@ -219,11 +268,6 @@ void assemble_bristol(Analysis &analysis, unsigned int max_depth,
       }
     }
 
-    // check for low water mark goes here to make sure we did not break
-    // anything
-
-    reg_active_map[jx] = true; // mark register as used
-
     /////////////////////////////////////////////////////////////////////////
     // get the node number of the output
     unsigned int current_out_node =
@@ -231,6 +275,7 @@ void assemble_bristol(Analysis &analysis, unsigned int max_depth,
 
     // and save it
     reg_node_map[jx] = current_out_node;
+    node_reg_map[current_out_node] = jx;
     unsigned int current_out_reg =
         jx; // keep track of the current output register #
 
@@ -239,33 +284,6 @@ void assemble_bristol(Analysis &analysis, unsigned int max_depth,
               jx + ADD_IT);
     }
 
-    /////////////////////////////////////////////////////////////////////////
-    // get the node numbers of the inputs
-
-    auto invarlist = f.in_list[line_ix]; // get input node list
-    std::vector<unsigned int> invarnamelist(invarlist.size());
-
-    for (uint jx = 0; jx < invarlist.size(); jx++) {
-      // for each input in the list, find the register_node it is mapped to
-
-      // invarnamelist should be renamed to invar_reg_node_map_index or
-      // something
-      auto it =
-          std::find(reg_node_map.begin(), reg_node_map.end(), invarlist[jx]);
-
-      if (it != reg_node_map.end()) {
-        // std::cout << "Element " << invarlist[jx] <<" found at position : " ;
-        // std::cout << std::distance(reg_node_map.begin(), it) << " (counting
-        // from zero) \n" ;
-        invarnamelist[jx] = std::distance(reg_node_map.begin(), it);
-      } else {
-        std::cout
-            << "input register not found in reg_node_map! fatal error, exiting!"
-            << std::endl;
-        exit(-1);
-      }
-    }
-
     /////////////////////////////////////////////////////////////////////////
     //  generate the line of assembly output
     std::string name = f.call_list[line_ix]; // get func name
@@ -372,22 +390,18 @@ void assemble_bristol(Analysis &analysis, unsigned int max_depth,
       fprintf(fid, "#parse error on line %d\n", line_ix);
     }
 
-    //  get the number of used (nonfalse) registers in the map for this line
-    active_reg_count[line_ix] =
-        std::count_if(reg_active_map.begin(), reg_active_map.end(),
-                      [](bool c) { return c != false; });
+    // a node that is never read again is dead as soon as it is written
+    if ((v.high_water[current_out_node] == line_ix) &&
+        releasable(current_out_node)) {
+      reg_node_map[current_out_reg] = -1;
+      node_reg_map[current_out_node] = -1;
+      free_regs.push_back(current_out_reg);
+    }
 
     //  if it is a terminal output (i.e. one that gets read out of the alu
-    // out_ix = find(out_map == current_out_node);
-
-    auto it = std::find(out_map.begin(), out_map.end(), current_out_node);
-
-    if (it != out_map.end()) {
-      // std::cout << "Element " << invarlist[jx] <<" found at position : " ;
-      // std::cout << std::distance(out_map.begin(), it) << " (counting from
-      // zero) \n" ;
+    long out_ix = node_out_map[current_out_node];
 
-      auto out_ix = std::distance(out_map.begin(), it);
+    if (out_ix >= 0) {
 
       if (!delayed_get_flag) {
         // write out the STORE command right away.
@@ -420,10 +434,17 @@ void assemble_bristol(Analysis &analysis, unsigned int max_depth,
   fprintf(fid, "# max depth supported: %d\n", max_depth);
   fprintf(fid, "# max depth required: %d\n", max_depth_required);
   fprintf(fid, "# max tower jump: %d\n", max_tower_jump);
-  fprintf(fid, "# %d registers used\n",
-          *max_element(active_reg_count.begin(), active_reg_count.end()));
+  // registers are only added when none is free, so this is also the
+  // largest number live at once
+  fprintf(fid, "# %d registers used\n", reg_counter);
   fprintf(fid, "# %d BOOT operations required\n", boot_counter);
 
   //  Close output file
   fclose(fid);
+  std::cout << std::endl
+            << "### Assembly time "
+            << std::chrono::duration_cast<std::chrono::milliseconds>(
+                   std::chrono::steady_clock::now() - t_start)
+                   .count()
+            << " msec for " << f.call_list.size() << " lines" << std::endl;
 }
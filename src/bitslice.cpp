@@ -0,0 +1,214 @@
+// @file bitslice.cpp -- bit sliced plaintext circuit evaluation
+//==================================================================================
+// BSD 2-Clause License
+//
+// Copyright (c) 2014-2022, NJIT, Duality Technologies Inc. and other
+// contributors
+//
+// All rights reserved.
+//
+// Author TPOC: contact@openfhe.org
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//==================================================================================
+#include "bitslice.h"
+
+#include <algorithm>
+#include <iostream>
+#include <omp.h>
+
+BitSliceEngine::BitSliceEngine(std::shared_ptr<const CompiledCircuit> ckt)
+    : ckt(ckt) {
+  // gates are in program order, so one pass over the flat list evaluates
+  // the circuit. I/O gates only move bits and need no instruction.
+  this->program.reserve(ckt->allGates.size());
+  for (const auto &g : ckt->allGates) {
+    Instruction ins;
+    ins.op = g.op;
+    switch (g.op) {
+    case (GateEnum::OUTPUT):
+      continue;
+    case (GateEnum::NOT):
+      ins.in0 = g.inWires[0];
+      ins.in1 = g.inWires[0];
+      break;
+    case (GateEnum::AND):
+    case (GateEnum::OR):
+    case (GateEnum::XOR):
+    case (GateEnum::NAND):
+    case (GateEnum::NOR):
+    case (GateEnum::XNOR):
+      ins.in0 = g.inWires[0];
+      ins.in1 = g.inWires[1];
+      break;
+    case (GateEnum::AND3):
+    case (GateEnum::OR3):
+    case (GateEnum::MAJORITY):
+      ins.in0 = g.inWires[0];
+      ins.in1 = g.inWires[1];
+      ins.in2 = g.inWires[2];
+      break;
+    case (GateEnum::LUT3):
+    case (GateEnum::LUT4):
+      ins.in0 = g.inWires[0];
+      ins.in1 = g.inWires[0];
+      ins.lut = &g;
+      break;
+    default:
+      std::cerr << "error bit slice engine cannot evaluate gate "
+                << g.getName() << std::endl;
+      exit(-1);
+    }
+    ins.out = g.outWires[0];
+    this->program.push_back(ins);
+  }
+}
+
+BitSliceEngine::~BitSliceEngine(void) {}
+
+unsigned int BitSliceEngine::VectorsPerPass(void) {
+  return 64 * BITSLICE_WORDS;
+}
+
+std::vector<Outputs>
+BitSliceEngine::Evaluate(const std::vector<Inputs> &batch) const {
+  std::vector<Outputs> out(batch.size());
+  const size_t per_pass = VectorsPerPass();
+  const size_t n_passes = (batch.size() + per_pass - 1) / per_pass;
+  const size_t n_wires = this->ckt->numberWires();
+  if (n_passes == 1) {
+    std::vector<Slice> wires(n_wires);
+    _Pass(batch, 0, batch.size(), wires, out);
+    return out;
+  }
+  // passes are independent, each thread keeps its own wire slices
+#pragma omp parallel
+  {
+    std::vector<Slice> wires(n_wires);
+#pragma omp for schedule(dynamic)
+    for (size_t p = 0; p < n_passes; p++) {
+      size_t first = p * per_pass;
+      _Pass(batch, first, std::min(per_pass, batch.size() - first), wires,
+            out);
+    }
+  }
+  return out;
+}
+
+Outputs BitSliceEngine::Evaluate(const Inputs &input) const {
+  return Evaluate(std::vector<Inputs>(1, input))[0];
+}
+
+void BitSliceEngine::_Pass(const std::vector<Inputs> &batch, size_t first,
+                           size_t n, std::vector<Slice> &wires,
+                           std::vector<Outputs> &out) const {
+  // transpose the input bits of vectors first..first+n-1 into slices
+  const Slice zero = {};
+  for (const auto &g : this->ckt->inputGates) {
+    Slice s = zero;
+    for (size_t v = 0; v < n; v++) {
+      uint64_t bit = batch[first + v][g.ioBus][g.ioBit] & 1;
+      s[v / 64] |= bit << (v % 64);
+    }
+    for (auto w : g.outWires) {
+      wires[w] = s;
+    }
+  }
+
+  for (const auto &ins : this->program) {
+    const Slice &a = wires[ins.in0];
+    const Slice &b = wires[ins.in1];
+    switch (ins.op) {
+    case (GateEnum::NOT):
+      wires[ins.out] = ~a;
+      break;
+    case (GateEnum::AND):
+      wires[ins.out] = a & b;
+      break;
+    case (GateEnum::OR):
+      wires[ins.out] = a | b;
+      break;
+    case (GateEnum::XOR):
+      wires[ins.out] = a ^ b;
+      break;
+    case (GateEnum::NAND):
+      wires[ins.out] = ~(a & b);
+      break;
+    case (GateEnum::NOR):
+      wires[ins.out] = ~(a | b);
+      break;
+    case (GateEnum::XNOR):
+      wires[ins.out] = ~(a ^ b);
+      break;
+    case (GateEnum::AND3):
+      wires[ins.out] = a & b & wires[ins.in2];
+      break;
+    case (GateEnum::OR3):
+      wires[ins.out] = a | b | wires[ins.in2];
+      break;
+    case (GateEnum::MAJORITY): {
+      const Slice &c = wires[ins.in2];
+      wires[ins.out] = (a & b) | (c & (a | b));
+      break;
+    }
+    case (GateEnum::LUT3):
+    case (GateEnum::LUT4): {
+      // OR of the minterms of the rows the table is true on
+      const Gate &g = *ins.lut;
+      Slice s = zero;
+      unsigned int rows = 1 << g.inWires.size();
+      for (unsigned int r = 0; r < rows; r++) {
+        if ((g.truthTable >> r) & 1) {
+          Slice m = ~zero;
+          for (size_t i = 0; i < g.inWires.size(); i++) {
+            const Slice &x = wires[g.inWires[i]];
+            m &= ((r >> i) & 1) ? x : ~x;
+          }
+          s |= m;
+        }
+      }
+      wires[ins.out] = s;
+      break;
+    }
+    default:
+      break;
+    }
+  }
+
+  // and transpose the output slices back to one Outputs per vector
+  for (size_t v = 0; v < n; v++) {
+    Outputs &o = out[first + v];
+    o.resize(this->ckt->n_outputs);
+    for (unsigned int ix = 0; ix < this->ckt->n_outputs; ix++) {
+      o[ix].assign(this->ckt->n_output_bits[ix], 0);
+    }
+  }
+  for (auto gid : this->ckt->outputGates) {
+    const Gate &g = this->ckt->allGates[gid];
+    const Slice &s = wires[g.inWires[0]];
+    for (size_t v = 0; v < n; v++) {
+      out[first + v][g.ioBus][g.ioBit] = (s[v / 64] >> (v % 64)) & 1;
+    }
+  }
+}
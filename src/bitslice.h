@@ -0,0 +1,87 @@
+// @file bitslice.h -- bit sliced plaintext circuit evaluation
+//==================================================================================
+// BSD 2-Clause License
+//
+// Copyright (c) 2014-2022, NJIT, Duality Technologies Inc. and other
+// contributors
+//
+// All rights reserved.
+//
+// Author TPOC: contact@openfhe.org
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//==================================================================================
+
+#ifndef SRC_BITSLICE_H_
+#define SRC_BITSLICE_H_
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "compiled.h"
+
+// number of 64 bit words evaluated together by one slice instruction,
+// as wide as the vector unit the code is compiled for
+#if defined(__AVX512F__)
+#define BITSLICE_WORDS 8 // 512 vectors per pass
+#elif defined(__AVX2__)
+#define BITSLICE_WORDS 4 // 256 vectors per pass
+#else
+#define BITSLICE_WORDS 1 // 64 vectors per pass
+#endif
+
+// one bit of every input vector in a pass, vector i in bit i % 64 of
+// word i / 64. logic ops on a Slice compile to single SIMD instructions.
+typedef uint64_t Slice __attribute__((vector_size(8 * BITSLICE_WORDS)));
+
+// plaintext evaluator: the compiled circuit is flattened into a list of
+// instructions on wire slices, and a batch of input vectors is evaluated
+// VectorsPerPass() vectors at a time, passes running in parallel.
+class BitSliceEngine {
+public:
+  explicit BitSliceEngine(std::shared_ptr<const CompiledCircuit> ckt);
+  ~BitSliceEngine();
+  // evaluate every input vector of batch, returns their outputs in order
+  std::vector<Outputs> Evaluate(const std::vector<Inputs> &batch) const;
+  Outputs Evaluate(const Inputs &input) const;
+  static unsigned int VectorsPerPass(void);
+
+private:
+  class Instruction {
+  public:
+    GateEnum op;
+    WireId in0, in1, in2; // in1 unused by NOT, in2 only by 3 input gates
+    WireId out;
+    const Gate *lut; // LUT gates: the gate, with its inputs and table
+  };
+
+  void _Pass(const std::vector<Inputs> &batch, size_t first, size_t n,
+             std::vector<Slice> &wires, std::vector<Outputs> &out) const;
+
+  std::shared_ptr<const CompiledCircuit> ckt;
+  std::vector<Instruction> program; // all logic gates in program order
+};
+
+#endif
@@ -35,65 +35,47 @@
 #include "circuit.h"
 
 #include <algorithm>
+#include <condition_variable>
 #include <fstream>
 #include <iostream>
-#include <sstream>
+#include <mutex>
+#include <sys/resource.h>
 
+#include "lutmap.h"
+#include "rewrite.h"
+#include "techmap.h"
 #include "utils.h"
-#include <boost/range/adaptor/reversed.hpp>
 
 Circuit::Circuit(lbcrypto::BINFHE_PARAMSET set,
-                 lbcrypto::BINFHE_METHOD method) {
+                 lbcrypto::BINFHE_METHOD method)
+    : Circuit(std::make_shared<const KeySet>(GenerateKeySet(set, method))) {}
+
+Circuit::Circuit(KeySetPtr keys) {
   // clear all flags
   this->plaintext_flag = false; // if true perform plaintext logic
   this->encrypted_flag = false; // if true perform encrypted logic
   this->verify_flag = false;    // if true verify plaintext vs encrypted logic
+  this->names_flag = false;     // if true keep wire names for debug
+  this->dataflow_flag = false;  // if true use dataflow execution
+  this->techmap_flag = false;   // if true map onto 3 input gates
+  this->pushnots_flag = false;  // if true fold NOTs into other gates
+  this->optimize_flag = false;  // if true optimize loaded circuits
+  this->rebalance_flag = false; // if true rebalance loaded circuits
+  this->lutInputs = 0;          // no LUT mapping
+  this->priority_flag = true;   // if true dispatch critical path first
+  this->maxLive = 0;            // no cap on live ciphertexts
+  this->n_held = 0;
+  this->busy_us = 0;
+  this->mgt_us = 0;
+  this->encrypt_ms = 0;
 
   this->done = false;
-  // create empty containers
-  this->nl = NetList(); // full net list of the ckt (all wires and fanout
-                        // gates)
-
-  this->waitingWireNames = WireNameList(0);
-  this->activeWires = WireQueue(0);
-
-  this->inputGates = GateList(0); // input gates in ckt
-  this->allGates = GateList(0);   // all other gates in ckt
-
-  this->readyGates = GateQueue(0);
-  this->waitingGates = GateQueue(0);
-  this->executingGates = GateQueue(0);
-  this->doneGates = GateQueue(0);
-  std::cout << "Generating crypto context" << std::endl;
-  this->cc = lbcrypto::BinFHEContext();
-  if (set == lbcrypto::TOY) {
-    std::cout << "*************************" << std::endl;
-    std::cout << "WARNING TOY Security used" << std::endl;
-    std::cout << "*************************" << std::endl;
-  } else if (set == lbcrypto::STD128Q_LMKCDEY) {
-    std::cout << "STD128Q_LMKCDEY Security used" << std::endl;
-  } else {
-    std::cerr << "Error Bad security" << std::endl;
-    exit(-1);
-  }
-  if (method == lbcrypto::AP) {
-    std::cout << "AP used" << std::endl;
-  } else if (method == lbcrypto::GINX) {
-    std::cout << "GINX used" << std::endl;
-  } else if (method == lbcrypto::LMKCDEY) {
-    std::cout << "LMKCDEY used" << std::endl;
-  } else {
-    std::cerr << "Error Bad method" << std::endl;
-    exit(-1);
-  }
-
-  this->cc.GenerateBinFHEContext(set, method);
-  std::cout << "Generating crypto keys" << std::endl;
-  this->sk = cc.KeyGen();
-  this->cc.BTKeyGen(this->sk);
-  std::cout << "Done" << std::endl;
-  this->gep.cc = this->cc;
-  this->gep.sk = this->sk;
+  // empty circuit until ReadFile() or Load()
+  this->ckt = std::make_shared<const CompiledCircuit>();
+  this->state.Init(*this->ckt);
+  // the context and keys are shared with the caller, not regenerated
+  this->keys = keys;
+  this->gep.keys = this->keys;
   this->gep.plaintext_flag = this->plaintext_flag;
   this->gep.encrypted_flag = this->encrypted_flag;
   this->gep.verify_flag = this->verify_flag;
@@ -109,6 +91,7 @@ bool Circuit::ReadFile(std::string inFname) {
   // //Plaintext out
   // std::vector <unsigned int> pout(n_out_bits, 0);
   std::cout << "Loading circuit description " << inFname << std::endl;
+  TIC(auto t_load);
 
   // open the program file to determine some parameters for tests
   std::ifstream inFile;
@@ -126,6 +109,30 @@ bool Circuit::ReadFile(std::string inFname) {
   unsigned int lineNo = 0;
   unsigned int gateNo = 0;
 
+  // the circuit is built into a new compiled circuit, then loaded
+  auto c = std::make_shared<CompiledCircuit>();
+  c->keepNames = this->names_flag;
+
+  // registers in the program may be reassigned, so every assignment
+  // creates a new wire. regWire maps a register to its current wire.
+  const WireId noWire = ~WireId(0);
+  std::vector<WireId> regWire;
+  auto defineReg = [&](unsigned int reg) {
+    if (reg >= regWire.size()) {
+      regWire.resize(reg + 1, noWire);
+    }
+    regWire[reg] = c->addWire("R:" + std::to_string(reg));
+    return regWire[reg];
+  };
+  auto useReg = [&](unsigned int reg) {
+    if ((reg >= regWire.size()) || (regWire[reg] == noWire)) {
+      std::cerr << "register R" << reg << " used before assignment line "
+                << lineNo << std::endl;
+      exit(-1);
+    }
+    return regWire[reg];
+  };
+
   unsigned int max_output_bits(0);
   std::string tline;
   try {
@@ -138,8 +145,6 @@ bool Circuit::ReadFile(std::string inFname) {
         continue; // ignore comment lines
       }
       Gate g;
-      g.plainin.resize(2);
-      g.encin.resize(2);
 
       unsigned int n1, n2, n3;
       unsigned int n;
@@ -153,22 +158,13 @@ bool Circuit::ReadFile(std::string inFname) {
         // create INPUT gate
         // load input n2, bit n3 to register n1
         // reg[n1] = in[n2-1][n3];
-        g.name = "INPUT:" + std::to_string(gateNo);
         g.op = GateEnum::INPUT;
-        std::string in1, in2, out1;
-        in1 = "IN:" + std::to_string(n2 - 1);
-        in2 = "BIT:" + std::to_string(n3);
-        out1 = "R:" + std::to_string(n1);
-        g.inWireNames.push_back(in1);
-        g.inWireNames.push_back(in2);
-        g.ready.push_back(false);
-        g.ready.push_back(false);
-        g.outWireNames.push_back(out1);
-        g.plainin.resize(1); // adjust to only one input
-        g.encin.resize(1);
+        g.ioBus = n2 - 1;
+        g.ioBit = n3;
+        g.outWires.push_back(defineReg(n1));
 
         gateNo++;
-        this->inputGates.push_back(g);
+        c->addGate(std::move(g));
 
       } else if (contains(tline, "STORE")) {
         n = sscanf(tline.c_str(), "Out%d = STORE(R%d)", &n1, &n2);
@@ -178,22 +174,14 @@ bool Circuit::ReadFile(std::string inFname) {
         }
         // store register n2 into out n1
         // out[n1] = reg[n2];
-        g.name = "OUTPUT:" + std::to_string(gateNo);
         g.op = GateEnum::OUTPUT;
-        std::string in1, out1, out2;
-        in1 = "R:" + std::to_string(n2);
+        g.inWires.push_back(useReg(n2));
         // right now there is only one output allowed
-        out1 = "OUT:" + std::to_string(0);
-        out2 = "BIT:" + std::to_string(n1);
-        g.inWireNames.push_back(in1);
-        g.ready.push_back(false);
-        g.outWireNames.push_back(out1);
-        g.outWireNames.push_back(out2);
-        g.plainin.resize(1); // adjust to only one input
-        g.encin.resize(1);
+        g.ioBus = 0;
+        g.ioBit = n1;
 
         gateNo++;
-        this->allGates.push_back(g);
+        c->addGate(std::move(g));
 
         // update the output bit size
         max_output_bits = std::max(max_output_bits, n1);
@@ -206,21 +194,12 @@ bool Circuit::ReadFile(std::string inFname) {
         }
 
         //  register n1 = not(register n2)
-        // store register n2 into out n1
-        // out[n1] = reg[n2];
-        g.name = "NOT:" + std::to_string(gateNo);
         g.op = GateEnum::NOT;
-        std::string in1, out1;
-        in1 = "R:" + std::to_string(n2);
-        out1 = "R:" + std::to_string(n1);
-        g.inWireNames.push_back(in1);
-        g.ready.push_back(false);
-        g.outWireNames.push_back(out1);
-        g.plainin.resize(1); // adjust to only one input
-        g.encin.resize(1);
+        g.inWires.push_back(useReg(n2));
+        g.outWires.push_back(defineReg(n1));
 
         gateNo++;
-        this->allGates.push_back(g);
+        c->addGate(std::move(g));
 
       } else if (contains(tline, "AND")) {
         n = sscanf(tline.c_str(), "R%d = AND(R%d, R%d)", &n1, &n2, &n3);
@@ -231,19 +210,12 @@ bool Circuit::ReadFile(std::string inFname) {
 
         //  register n1 = and(n2, n3)
         // reg[n1] = and(reg[n2], reg[n3]);
-        g.name = "AND:" + std::to_string(gateNo);
         g.op = GateEnum::AND;
-        std::string in1, in2, out1;
-        in1 = "R:" + std::to_string(n2);
-        in2 = "R:" + std::to_string(n3);
-        out1 = "R:" + std::to_string(n1);
-        g.inWireNames.push_back(in1);
-        g.inWireNames.push_back(in2);
-        g.ready.push_back(false);
-        g.ready.push_back(false);
-        g.outWireNames.push_back(out1);
+        g.inWires.push_back(useReg(n2));
+        g.inWires.push_back(useReg(n3));
+        g.outWires.push_back(defineReg(n1));
         gateNo++;
-        this->allGates.push_back(g);
+        c->addGate(std::move(g));
 
       } else if (contains(tline, " OR")) {
         n = sscanf(tline.c_str(), "R%d = OR(R%d, R%d)", &n1, &n2, &n3);
@@ -255,19 +227,12 @@ bool Circuit::ReadFile(std::string inFname) {
         //  register n1 = or(n2, n3)
         // reg[n1] = or(reg[n2], reg[n3]);
         // reg[n1] = reg[n2] or reg[n3];
-        g.name = "OR:" + std::to_string(gateNo);
         g.op = GateEnum::OR;
-        std::string in1, in2, out1;
-        in1 = "R:" + std::to_string(n2);
-        in2 = "R:" + std::to_string(n3);
-        out1 = "R:" + std::to_string(n1);
-        g.inWireNames.push_back(in1);
-        g.inWireNames.push_back(in2);
-        g.ready.push_back(false);
-        g.ready.push_back(false);
-        g.outWireNames.push_back(out1);
+        g.inWires.push_back(useReg(n2));
+        g.inWires.push_back(useReg(n3));
+        g.outWires.push_back(defineReg(n1));
         gateNo++;
-        this->allGates.push_back(g);
+        c->addGate(std::move(g));
 
       } else if (contains(tline, "XOR")) {
         n = sscanf(tline.c_str(), "R%d = XOR(R%d, R%d)", &n1, &n2, &n3);
@@ -277,19 +242,12 @@ bool Circuit::ReadFile(std::string inFname) {
         }
         //  register n1 = xor(n2, n3)
         // reg[n1] = xor(reg[n2], reg[n3]);
-        g.name = "XOR:" + std::to_string(gateNo);
         g.op = GateEnum::XOR;
-        std::string in1, in2, out1;
-        in1 = "R:" + std::to_string(n2);
-        in2 = "R:" + std::to_string(n3);
-        out1 = "R:" + std::to_string(n1);
-        g.inWireNames.push_back(in1);
-        g.inWireNames.push_back(in2);
-        g.ready.push_back(false);
-        g.ready.push_back(false);
-        g.outWireNames.push_back(out1);
+        g.inWires.push_back(useReg(n2));
+        g.inWires.push_back(useReg(n3));
+        g.outWires.push_back(defineReg(n1));
         gateNo++;
-        this->allGates.push_back(g);
+        c->addGate(std::move(g));
 
       } else if (contains(tline, "BOOT")) {
         // No op
@@ -313,152 +271,211 @@ bool Circuit::ReadFile(std::string inFname) {
   std::cout << std::endl
             << "generating output nbits " << max_output_bits << std::endl;
 
-  this->n_outputs = 1; // fixed for now
-  this->n_output_bits.resize(1);
-  this->n_output_bits[0] = max_output_bits;
-  this->circuitOut.resize(1);
-  this->circuitOut[0].resize(max_output_bits);
-  std::cout << "circuit out size " << this->circuitOut.size() << std::endl;
-  std::cout << "circuit[0] out size " << this->circuitOut[0].size()
-            << std::endl;
-
-  // generate netlist
-  std::cout << "generating netlist" << std::endl;
-  // start with input gates
-  for (auto og : this->inputGates) { // for all input gates
-
-    for (auto ow : og.outWireNames) { // for each output
-      GateNameList fanout(0);
-      fanout.reserve(16);                // arbitrary
-      for (auto ig : this->allGates) {   // loop through all gates
-        for (auto iw : ig.inWireNames) { // for all input wires.
-          if (ow == iw) {
-            fanout.push_back(ig.name);
-          }
-        }
-      }
-      nl.insert({ow, fanout});
-    }
-  }
-  // repeat for the remaining gates
-  for (auto og : this->allGates) {    // for all input gates
-    for (auto ow : og.outWireNames) { // for each output
-      GateNameList fanout(0);
-      for (auto ig : this->allGates) {   // loop through all gates
-        for (auto iw : ig.inWireNames) { // for all input wires.
-          if (ow == iw) {
-            fanout.push_back(ig.name);
-          }
-        }
-      }
-      nl.insert({ow, fanout});
-    }
-  }
+  c->setOutputBits({max_output_bits}); // fixed to one bus for now
+  std::cout << "circuit out size " << c->n_outputs << std::endl;
+  std::cout << "circuit[0] out size " << c->n_output_bits[0] << std::endl;
 
-  // clear all other queues
-  waitingWireNames.clear();
-  activeWires.clear();
-
-  waitingGates.clear();
-  readyGates.clear();
-  executingGates.clear();
-  doneGates.clear();
+  // the netlist was indexed gate by gate during parsing
+  c->finalize();
+  this->Load(c);
   std::cout << "Done" << std::endl;
+  std::cout << "### Load time " << TOC_MS(t_load) << " msec for "
+            << c->inputGates.size() + c->allGates.size() << " gates"
+            << std::endl;
   return true;
 }
 
-void Circuit::Reset(void) {
-  OPENFHE_DEBUG_FLAG(false);
+bool Circuit::ReadBristol(std::string bristolName, bool new_flag) {
+  std::cout << "Loading Bristol circuit " << bristolName << std::endl;
+  this->Load(analyze_bristol(bristolName, new_flag));
+  return true;
+}
 
-  // clear counters
-  this->n_input_gates = 0;
-  this->n_output_gates = 0;
-  this->n_and_gates = 0;
-  this->n_or_gates = 0;
-  this->n_xor_gates = 0;
-  this->n_not_gates = 0;
+void Circuit::SaveCompiled(std::string fname) { this->ckt->Save(fname); }
 
-  // clear all flags
-  this->plaintext_flag = false;
-  this->encrypted_flag = false;
-  this->verify_flag = false;
+bool Circuit::ReadCompiled(std::string fname) {
+  std::cout << "Loading compiled circuit " << fname << std::endl;
+  TIC(auto t_load);
+  auto c = CompiledCircuit::Map(fname);
+  this->Load(c);
+  std::cout << "### Load time " << TOC_MS(t_load) << " msec for "
+            << c->inputGates.size() + c->allGates.size() << " gates"
+            << std::endl;
+  return true;
+}
 
-  this->done = false;
+void Circuit::Load(const Analysis &analysis) {
+  // Bristol nodes are single assignment and the gates are in program
+  // order, so every node becomes one wire and every gate line one gate.
+  // inputs are the first nodes, bus by bus, and outputs the last ones.
+  TIC(auto t_load);
+  const Variable &v = analysis.variables;
+  const Function &f = analysis.functions;
+  auto c = std::make_shared<CompiledCircuit>();
+  c->keepNames = this->names_flag;
+
+  // a node copied with EQW shares the wire of its source
+  std::vector<WireId> nodeWire(v.n_tot);
+  for (unsigned int node = 0; node < v.n_tot; node++) {
+    nodeWire[node] =
+        c->addWire(c->keepNames ? "N:" + std::to_string(node) : "");
+  }
 
-  // clear all queues and lists
-  waitingWireNames.clear();
-  activeWires.clear();
+  unsigned int node = 0;
+  for (unsigned int bus = 0; bus < v.in_bits.size(); bus++) {
+    for (unsigned int bit = 0; bit < v.in_bits[bus]; bit++) {
+      Gate g;
+      g.op = GateEnum::INPUT;
+      g.ioBus = bus;
+      g.ioBit = bit;
+      g.outWires.push_back(nodeWire[node++]);
+      c->addGate(std::move(g));
+    }
+  }
 
-  waitingGates.clear();
-  readyGates.clear();
-  executingGates.clear();
-  examinedGates.clear();
-  doneGates.clear();
+  for (size_t line = 0; line < f.call_list.size(); line++) {
+    const auto &name = f.call_list[line];
+    const auto &in = f.in_list[line];
+    const auto &out = f.out_list[line];
+    // XOR and AND read two nodes, NOT (INV) and EQW one, all write one
+    size_t n_in = ((name == "XOR") || (name == "AND")) ? 2 : 1;
+    if ((in.size() != n_in) || (out.size() != 1)) {
+      std::cerr << "cannot load " << name << " gate with " << in.size()
+                << " inputs and " << out.size() << " outputs on line "
+                << line << std::endl;
+      exit(-1);
+    }
+    if (name == "EQW") {
+      nodeWire[out[0]] = nodeWire[in[0]];
+      continue;
+    }
+    Gate g;
+    if (name == "XOR") {
+      g.op = GateEnum::XOR;
+    } else if (name == "AND") {
+      g.op = GateEnum::AND;
+    } else if (name == "NOT") {
+      g.op = GateEnum::NOT;
+    } else {
+      std::cerr << "cannot load " << name << " gate on line " << line
+                << std::endl;
+      exit(-1);
+    }
+    for (auto n : in) {
+      g.inWires.push_back(nodeWire[n]);
+    }
+    g.outWires.push_back(nodeWire[out[0]]);
+    c->addGate(std::move(g));
+  }
 
-  // load all gates (except input) to waitingGate queue from allGates;
-  for (auto g : this->allGates) {
-    waitingGates.push_back(g);
+  unsigned int n_out_bits = 0;
+  for (auto bits : v.out_bits) {
+    n_out_bits += bits;
+  }
+  node = v.n_tot - n_out_bits;
+  for (unsigned int bus = 0; bus < v.out_bits.size(); bus++) {
+    for (unsigned int bit = 0; bit < v.out_bits[bus]; bit++) {
+      Gate g;
+      g.op = GateEnum::OUTPUT;
+      g.ioBus = bus;
+      g.ioBit = bit;
+      g.inWires.push_back(nodeWire[node++]);
+      c->addGate(std::move(g));
+    }
   }
+  c->setOutputBits(v.out_bits);
 
-  // reserve capacity for all other gateQueues
-  // auto maxGates = waitingGates.size();
-  // readyGates.reserve(maxGates);
-  readyGates.clear(); // capacity should be unchanged
-  // executingGates.reserve(maxGates);
-  executingGates.clear();
-  // examinedGates.reserve(maxGates);
-  examinedGates.clear();
-  // doneGates.reserve(maxGates);
-  doneGates.clear();
+  c->finalize();
+  this->Load(c);
+  std::cout << "### Load time " << TOC_MS(t_load) << " msec for "
+            << c->inputGates.size() + c->allGates.size() << " gates"
+            << std::endl;
+}
 
-  OPENFHE_DEBUG("reset: before waiting gates size: " << waitingGates.size());
-  // load all wirenames to waitingWire queue from netlist
-  for (auto const &w : this->nl) {
-    waitingWireNames.push_back(w.first);
+void Circuit::Load(std::shared_ptr<const CompiledCircuit> compiled) {
+  // only the per evaluation state is allocated here, the gate list and
+  // netlist are shared with every other user of the compiled circuit
+  // a LUT mapped circuit has no gates the other passes could rewrite
+  bool lut = compiled->lutMapped || (compiled->plaintextModulus > 4);
+  if (this->optimize_flag && !compiled->optimized && !lut) {
+    compiled = Optimize(*compiled, this->constantInputs);
   }
-  OPENFHE_DEBUG(
-      "reset: now waiting wirename size: " << waitingWireNames.size());
+  if (this->rebalance_flag && !compiled->rebalanced && !lut) {
+    compiled = Rebalance(*compiled);
+  }
+  if ((this->lutInputs != 0) && !lut) {
+    compiled = LutMap(*compiled, this->lutInputs);
+    lut = true;
+  }
+  if (this->techmap_flag && !compiled->techMapped && !lut) {
+    compiled = TechMap(*compiled);
+  }
+  // after the tech map, which may add NOTs for inverted gate inputs
+  if (this->pushnots_flag && !compiled->inversionsPushed && !lut) {
+    compiled = PushInversions(*compiled);
+  }
+  this->ckt = compiled;
+  this->plainEngine = nullptr;
+  // one EvalFunc table for each truth table, shared by its LUT gates
+  this->gep.plaintextModulus = compiled->plaintextModulus;
+  this->gep.lutTables.clear();
+  for (const auto &g : compiled->allGates) {
+    if (((g.op == GateEnum::LUT3) || (g.op == GateEnum::LUT4)) &&
+        !this->gep.lutTables.count(g.truthTable)) {
+      this->gep.lutTables[g.truthTable] =
+          GenerateLutTable(*this->keys, g.truthTable,
+                           compiled->plaintextModulus);
+    }
+  }
+  this->state.Init(*this->ckt);
+  this->setPriority(this->priority_flag);
+  this->done = false;
 }
 
-bool Circuit::_parse_input(Inputs input, std::string input_name,
-                           std::string bit_name) {
-  // input_name is IN:#  bit_name is BIT:#
+std::shared_ptr<const CompiledCircuit> Circuit::getCompiled(void) {
+  return this->ckt;
+}
 
-  std::stringstream s1(input_name);
-  std::string token;
-  getline(s1, token, ':'); // get the IN
-  getline(s1, token, ':'); // get the #
-  size_t in_num(std::stoi(token));
+std::string Circuit::_wire_name(WireId w) { return this->ckt->wireName(w); }
 
-  std::stringstream s2(bit_name);
-  getline(s2, token, ':'); // get the BIT
-  getline(s2, token, ':'); // get the #
-  size_t bit_num(std::stoi(token));
-  return input[in_num][bit_num];
-}
+void Circuit::Reset(void) {
+  OPENFHE_DEBUG_FLAG(false);
 
-void Circuit::_parse_output(std::string out_name, std::string bit_name,
-                            bool value) {
-  // output_name is OUT:#  bit_name is BIT:#
+  // clear all flags
+  this->plaintext_flag = false;
+  this->encrypted_flag = false;
+  this->verify_flag = false;
 
-  std::stringstream s1(out_name);
-  std::string token;
-  getline(s1, token, ':'); // get the IN
-  getline(s1, token, ':'); // get the #
-  size_t out_num(std::stoi(token));
+  this->done = false;
 
-  std::stringstream s2(bit_name);
-  getline(s2, token, ':'); // get the BIT
-  getline(s2, token, ':'); // get the #
-  size_t bit_num(std::stoi(token));
-  circuitOut[out_num][bit_num] = value;
+  // O(1), stale gate and wire state is cleared lazily as it is touched
+  this->state.Reset();
+  OPENFHE_DEBUG("reset: generation started for "
+                << this->ckt->allGates.size() << " gates");
 }
 
 void Circuit::SetInput(Inputs input, bool verbose) {
+  this->SetInput(std::vector<Inputs>(1, std::move(input)), verbose);
+}
+
+void Circuit::SetInput(const std::vector<Inputs> &batch, bool verbose) {
   OPENFHE_DEBUG_FLAG(false);
 
+  if (batch.empty()) {
+    std::cerr << "error: SetInput() with an empty batch" << std::endl;
+    exit(-1);
+  }
+  if (batch.size() != this->state.lanes) {
+    // resize the evaluation state for the new number of requests
+    this->state.Init(*this->ckt, batch.size());
+  }
+  unsigned int lanes = this->state.lanes;
+  if (verbose && (lanes > 1))
+    std::cout << "setting input for " << lanes << " requests" << std::endl;
+
   // parse input;
-  // determine input dimensions
+  // determine input dimensions, all requests have the same shape
+  const Inputs &input = batch[0];
   auto n_inputs = input.size();
   std::vector<unsigned int> in_size(n_inputs);
   size_t ix = 0;
@@ -477,48 +494,45 @@ void Circuit::SetInput(Inputs input, bool verbose) {
   if (verbose)
     std::cout << "set input total of " << total_inputs << " inputs"
               << std::endl;
+  // an input declared constant was folded away by Optimize(), any other
+  // value would give wrong outputs without a sign
+  for (const auto &c : this->constantInputs) {
+    for (const auto &in : batch) {
+      if ((c.first.first >= in.size()) ||
+          (c.first.second >= in[c.first.first].size()) ||
+          ((in[c.first.first][c.first.second] & 1) != c.second)) {
+        std::cerr << "error input " << c.first.first << " bit "
+                  << c.first.second << " is declared constant " << c.second
+                  << " but is not set to it in SetInput()" << std::endl;
+        exit(-1);
+      }
+    }
+  }
+
   size_t inputs_used = 0;
-  this->n_input_gates = 0;
+  this->state.n_input_gates = 0;
+  this->plainInputs = batch; // for bit sliced plaintext runs
   // for each gate on input gate list
-  for (auto g : this->inputGates) {
-    OPENFHE_DEBUG("parsing gate " << g.name);
-    auto this_input = g.inWireNames[0];
-
-    auto this_bit = g.inWireNames[1];
-
-    auto value = _parse_input(input, this_input, this_bit);
-    // auto n_out = g.outWireNames.size();
-    this->n_input_gates++;
+  for (const auto &g : this->ckt->inputGates) {
+    OPENFHE_DEBUG("parsing gate " << g.getName());
+    this->state.n_input_gates++;
     // create output wires from gate output list
-    for (auto outName : g.outWireNames) {
-      Wire w;
-      w.setName(outName);
-      w.setValue(value);
-
-      OPENFHE_DEBUG("in setInput setting wire " << outName << " to " << value);
-
-      // find fanout
-      auto it = this->nl.find(outName);
-      if (it == this->nl.end()) {
-        std::cerr << "error, could not find " << outName << " in netlist"
-                  << std::endl;
-      }
-      w.setFanoutGates(it->second);
-      if (encrypted_flag) {
-        w.setCipherText(this->cc.Encrypt(this->sk, value));
+    for (auto outId : g.outWires) {
+      for (unsigned int lane = 0; lane < lanes; lane++) {
+        bool value = batch[lane][g.ioBus][g.ioBit];
+        this->state.wire(outId, lane).setValue(value);
+        OPENFHE_DEBUG("in setInput setting wire " << outId << " to "
+                                                  << value);
       }
 
-      // remove from wire name from waitingWire list
-      auto oit = std::find(this->waitingWireNames.begin(),
-                           this->waitingWireNames.end(), outName);
-      if (oit == this->waitingWireNames.end()) {
-        std::cerr << "error can't find wire in waitingWireList in SetInput()"
-                  << std::endl;
+      // mark the wire driven
+      if (!this->state.driveWire(outId)) {
+        std::cerr << "error wire " << _wire_name(outId)
+                  << " already driven in SetInput()" << std::endl;
       }
-      this->waitingWireNames.erase(oit);
 
       // push onto activeWires queue
-      this->activeWires.push_back(w);
+      this->state.activeWires.push_back(outId);
       inputs_used++;
     }
   }
@@ -529,9 +543,38 @@ void Circuit::SetInput(Inputs input, bool verbose) {
     if (verbose)
       std::cout << "input confirmed" << std::endl;
   }
+
+  this->encrypt_ms = 0;
+  if (encrypted_flag) {
+    // encrypt all input bits of all requests in parallel, each thread
+    // writes its own wires. OpenFHE keeps a random generator per OMP
+    // thread.
+    TIC(auto t_encrypt);
+    const auto &inputGates = this->ckt->inputGates;
+    // inputs of LUT circuits are encrypted fresh at their larger modulus
+    unsigned int p = this->ckt->plaintextModulus;
+    auto output = (p == 4) ? lbcrypto::BOOTSTRAPPED : lbcrypto::FRESH;
+    size_t n_work = inputGates.size() * lanes;
+#pragma omp parallel for
+    for (size_t k = 0; k < n_work; k++) {
+      unsigned int lane = k % lanes;
+      for (auto outId : inputGates[k / lanes].outWires) {
+        bool value = this->state.wire(outId, lane).getValue();
+        this->state.holdCipherText(
+            *this->ckt, outId, lane,
+            this->keys->cc.Encrypt(this->keys->sk, value, output, p));
+      }
+    }
+    this->encrypt_ms = TOC_MS(t_encrypt);
+  }
 }
 
 Outputs Circuit::Clock(void) {
+  // a single request, or the first request of a batch
+  return this->ClockBatch()[0];
+}
+
+std::vector<Outputs> Circuit::ClockBatch(void) {
   TIC(auto t_total);
   unsigned int management_time = 0;
   unsigned int execution_time = 0;
@@ -541,8 +584,32 @@ Outputs Circuit::Clock(void) {
     std::cerr << "done ckt clocked! should reset" << std::endl;
     exit(-1);
   }
-  while (!this->activeWires.empty() && !this->done) {
-  std::cout << "\r                            " << std::flush;
+  this->busy_us = 0;
+  this->mgt_us = 0;
+  this->n_held = 0;
+  // plaintext only runs do not need the gate by gate machinery
+  bool bitslice_flag = this->plaintext_flag && !this->encrypted_flag;
+  if (bitslice_flag) {
+    std::cout << "\r executing bit sliced... " << std::flush;
+    TIC(auto t_execution);
+    _ExecuteBitSliced();
+    execution_time += TOC_MS(t_execution);
+    this->busy_us = execution_time * 1000;
+    this->done = true;
+  } else if (this->dataflow_flag || this->maxLive) {
+    // no per level barrier, gates are managed as soon as they complete.
+    // the memory cap is only enforced here
+    std::cout << "\r executing dataflow... " << std::flush;
+    TIC(auto t_execution);
+    _ExecuteDataflow();
+    execution_time += TOC_MS(t_execution);
+    management_time = this->mgt_us / 1000;
+    if (this->state.n_done == this->ckt->allGates.size()) {
+      this->done = true;
+    }
+  }
+  while (!this->state.activeWires.empty() && !this->done) {
+    std::cout << "\r                            " << std::flush;
     std::cout << "\r managing... " << std::flush;
     TIC(auto t_management);
     _CircuitManager(); // puts tasks on executingGate
@@ -553,10 +620,16 @@ Outputs Circuit::Clock(void) {
     TIC(auto t_execution);
     _ExecuteGates();
     execution_time += TOC_MS(t_execution);
-    if (doneGates.size() == allGates.size()) {
+    if (this->state.n_done == this->ckt->allGates.size()) {
       this->done = true;
     }
   }
+  unsigned int decryption_time = 0;
+  if (this->encrypted_flag) {
+    TIC(auto t_decryption);
+    _DecryptOutputs();
+    decryption_time = TOC_MS(t_decryption);
+  }
   total_time = TOC_MS(t_total);
   // if very fast circuits...
   if (execution_time == 0)
@@ -564,128 +637,136 @@ Outputs Circuit::Clock(void) {
   if (total_time == 0)
     total_time = 1;
 
+  std::cout << std::endl
+            << "### Encryption time " << this->encrypt_ms << " msec"
+            << std::endl;
   std::cout << std::endl
             << "### Management time " << management_time << " msec" << std::endl;
   std::cout << std::endl
             << "### Execution time " << execution_time << " msec" << std::endl;
+  std::cout << std::endl
+            << "### Decryption time " << decryption_time << " msec"
+            << std::endl;
   std::cout << std::endl
             << "### Total time " << total_time << " msec" << std::endl;
   std::cout << std::endl
             << "efficiency "
             << float(execution_time) / float(total_time) * 100.0 << "%"
             << std::endl;
+  // fraction of the available thread time spent evaluating gates
+  int n_proc = omp_get_max_threads();
+  std::cout << std::endl
+            << "### Core utilization "
+            << float(this->busy_us) / (float(total_time) * 1000.0 * n_proc) *
+                   100.0
+            << "% of " << n_proc << " threads ("
+            << (bitslice_flag          ? "bit sliced"
+                : this->maxLive       ? "memory bounded dataflow"
+                : this->dataflow_flag ? "dataflow"
+                                      : "level by level")
+            << ", "
+            << (this->getPriority() ? "critical path first" : "FIFO")
+            << ")" << std::endl;
+  std::cout << std::endl
+            << "### Throughput "
+            << float(this->state.lanes) / float(total_time) * 1000.0
+            << " requests/sec for a batch of " << this->state.lanes
+            << std::endl;
+  if (this->encrypted_flag) {
+    std::cout << std::endl
+              << "### Peak live ciphertexts "
+              << this->state.peakLiveCipherTexts;
+    if (this->maxLive) {
+      std::cout << " (cap " << this->maxLive << ", " << this->n_held
+                << " thread waits held back by the cap)";
+    }
+    std::cout << std::endl;
+  }
+  // high water mark of the whole process so far
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  std::cout << std::endl
+            << "### Peak resident memory " << usage.ru_maxrss / 1024
+            << " MB" << std::endl;
+
+  return this->state.circuitOut;
+}
+
+std::vector<GateId> Circuit::ReadyGates(void) {
+  // propagate the wires driven since the last step and hand out every
+  // gate that is now ready
+  _PropagateWires();
+  std::vector<GateId> gids;
+  while (!this->state.executingGates.empty()) {
+    gids.push_back(this->state.executingGates.pop());
+  }
+  return gids;
+}
 
-  return this->circuitOut;
+void Circuit::EvaluateGate(GateId gid, unsigned int lane) {
+  _EvaluateGate(gid, lane);
+}
+
+void Circuit::RetireGate(GateId gid) {
+  _RetireGate(gid);
+  if (this->state.n_done == this->ckt->allGates.size()) {
+    this->done = true;
+  }
+}
+
+size_t Circuit::GatesLeft(void) {
+  return this->ckt->allGates.size() - this->state.n_done;
+}
+
+std::vector<Outputs> Circuit::DecryptOutputs(void) {
+  if (this->encrypted_flag) {
+    _DecryptOutputs();
+  }
+  return this->state.circuitOut;
 }
 
 void Circuit::_CircuitManager(void) {
   OPENFHE_DEBUG_FLAG(false);
   TIC(auto t_mgt_tot);
-  unsigned int cleanup_time = 0;
   unsigned int total_mgt_time = 0;
 
-  // the basic flow is:
-  // for each active wire pop it of the active queue
-  //  compare against each waiting gate
-  //    if waiting gate is in the wire's fanout
-  //       prepare that gate input and check if gate is ready to put on the
-  //       execute queue otherwise push it on the examined queue
-  //    then remove it from that wire's fanout
-  //  if the wire's fanout is not empty push it to the front of the active queue
-
-  // get wire (note if list is empty, then move on to processing gates
-  // and need to return to  wait
   OPENFHE_DEBUG("@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@");
-  while (!this->activeWires.empty()) {
-    OPENFHE_DEBUG("CM top wg: " << waitingGates.size()
-                                << " aw: " << activeWires.size());
-
-    auto inw = this->activeWires.front();
-    this->activeWires.pop_front();
-    // OPENFHE_DEBUG("after pop # active wire "<< activeWires.size());
-    // OPENFHE_DEBUG("### check wire "<<inw.getName() );
-    if (waitingGates.empty()) {
-      std::cerr << "error in CircuitManager: empty watingGates queue "
-                << std::endl;
-    }
-    examinedGates.clear();
-    bool wire_done = false;
-    while (!wire_done && !waitingGates.empty()) { // short ckt for wire done
-      auto g = waitingGates.front();
-      waitingGates.pop_front();
-      // OPENFHE_DEBUG("  ## examining gate "<<g.name);
-      auto n_in = g.inWireNames.size();
-
-      bool gateReady(true);
-      auto f = inw.getFanoutGates();
-      auto it = std::find(f.begin(), f.end(), g.name);
-      if (it != f.end()) { // if g.name in inw.fanoutGates
-        OPENFHE_DEBUG("  found gate " << g.name << " in fanout");
-        for (uint ix = 0; ix < n_in; ix++) {
-          if (g.inWireNames[ix] == inw.getName()) {
-            // mark this gate input ready
-            g.ready[ix] = true;
-            // copy the value and the ciphertext
-            g.encin[ix] = inw.getCipherText();
-            g.plainin[ix] = inw.getValue();
-            // OPENFHE_DEBUG("    input "<<ix );
-          }
-          gateReady &= g.ready[ix]; // any unready inputs turn this off
-        }
-        if (gateReady) {
-          this->executingGates.push_back(g);
-          OPENFHE_DEBUG("  ->execute:  " << this->executingGates.size());
-        } else {
-          examinedGates.push_back(g);
-          OPENFHE_DEBUG("  ->examined: " << examinedGates.size());
-        }
-        // remove this gate from this wire’s fanout
-        inw.updateFanoutGates(g.name);
-        // OPENFHE_DEBUG("  updated wire fanout on "<<inw.getName()
-        //   << " now length "
-        //   << inw.getFanoutGates().size() );
-        if (inw.getNumberFanoutGates() != 0) {
-          // OPENFHE_DEBUG("  wire not done");
-        } else {
-          wire_done = true;
-          // OPENFHE_DEBUG("  wire done");
-        }
-      } else {
-        // gate was not in current wire fanout.
-        examinedGates.push_back(g);
-      } // end if it!=end
-    }
-    TIC(auto t_clean);
-    // copy examined gates to waitingGates
-    OPENFHE_DEBUG("cycling gates #executing " << executingGates.size());
-    OPENFHE_DEBUG("cycling gates #examined " << examinedGates.size());
-    OPENFHE_DEBUG("cycling gates #waiting " << waitingGates.size());
-    OPENFHE_DEBUG("cycling gataes #done " << doneGates.size());
-
-    for (auto it : boost::adaptors::reverse(examinedGates)) {
-      waitingGates.push_front(it);
-    }
-    examinedGates.clear();
-    OPENFHE_DEBUG("cycled gates # waiting now " << waitingGates.size());
-
-    // push wire onto back of activeWires queue
-    if (!wire_done) {
-      activeWires.push_front(inw);
-      OPENFHE_DEBUG("pushing wire onto active " << inw.getName());
-    } else {
-      OPENFHE_DEBUG("wire done " << inw.getName());
-    }
-    OPENFHE_DEBUG("bottom of while waiting gates size: "
-                  << waitingGates.size() << " wire done " << wire_done);
-
-    OPENFHE_DEBUG("------------------");
-    cleanup_time += TOC_MS(t_clean);
-  } // while active wire is not empty
+  auto n_wires = _PropagateWires();
   OPENFHE_DEBUG("Manager Done Cycle");
   // active wire was empty. return so we can cycle again.
   total_mgt_time += TOC_MS(t_mgt_tot);
-  std::cout<<"\r                               tot mgt time "<<total_mgt_time <<" ms, cleanup time  "
-		   <<cleanup_time<< " ms       "<<std::flush;
+  std::cout << "\r                               tot mgt time "
+            << total_mgt_time << " ms, " << n_wires << " wires, "
+            << this->state.executingGates.size() << " gates ready     "
+            << std::flush;
+}
+
+unsigned int Circuit::_PropagateWires(void) {
+  OPENFHE_DEBUG_FLAG(false);
+  unsigned int n_wires = 0;
+
+  // the basic flow is:
+  // for each active wire pop it of the active queue
+  //  for each gate in the wire's fanout (from the netlist)
+  //    decrement the gate's count of pending inputs. when the count
+  //    reaches zero the gate is ready and is pushed on the execute queue.
+  //    the gate reads its input values from the wires when it executes.
+  // so each gate costs O(fan in) here, and each wire O(fan out).
+
+  while (!this->state.activeWires.empty()) {
+    auto wid = this->state.activeWires.front();
+    this->state.activeWires.pop_front();
+    n_wires++;
+
+    // a gate is listed once per input reading this wire
+    for (auto gid : this->ckt->nl[wid]) {
+      if (this->state.arriveInput(*this->ckt, gid) == 0) {
+        this->state.executingGates.push(gid);
+        OPENFHE_DEBUG("  ->execute:  " << this->ckt->allGates[gid].getName());
+      }
+    }
+  } // while active wire is not empty
+  return n_wires;
 }
 
 void Circuit::_ExecuteGates(void) {
@@ -696,24 +777,40 @@ void Circuit::_ExecuteGates(void) {
   int gates_now = 0;
   // For each gate on the executeGate queue in parallel
   OPENFHE_DEBUG("Execute start Cycle");
+  // tasks are created in ready queue order, so with priority on the
+  // gates on the critical path are started first. each gate is fanned
+  // out into one task per request lane.
+  GateIdList batch;
+  batch.reserve(this->state.executingGates.size());
+  while (!this->state.executingGates.empty()) {
+    batch.push_back(this->state.executingGates.pop());
+  }
   TIC(auto t_ex);
   // all gates on the executingGates queue can be Evaluated in parallel
 #if 0 // requires c++ 9.0 to compile  note could try using  __GNUC__ >8
 #pragma omp parallel for schedule(dynamic)
-  for (Gate & g: executingGates){
-	OPENFHE_DEBUG("processing gate "<<g.name);
-	g.Evaluate(this->gep);
+  for (GateId gid : batch) {
+    OPENFHE_DEBUG("processing gate " << gid);
+    for (unsigned int lane = 0; lane < this->state.lanes; lane++) {
+      _EvaluateGate(gid, lane);
+    }
   }
 #else
 #pragma omp parallel
   {
 #pragma omp single
     {
-      for (Gate &g : executingGates) {
-#pragma omp task shared(g)
-        {
-          OPENFHE_DEBUG("processing gate " << g.name);
-          g.Evaluate(this->gep);
+      for (GateId gid : batch) {
+        for (unsigned int lane = 0; lane < this->state.lanes; lane++) {
+#pragma omp task firstprivate(gid, lane)
+          {
+            OPENFHE_DEBUG("processing gate " << gid << " lane " << lane);
+            TIC(auto t_gate);
+            _EvaluateGate(gid, lane);
+            uint64_t gate_us = TOC_US(t_gate);
+#pragma omp atomic
+            this->busy_us += gate_us;
+          }
         }
       }
     }
@@ -721,125 +818,337 @@ void Circuit::_ExecuteGates(void) {
 #endif
   ex_time = TOC_MS(t_ex);
   OPENFHE_DEBUG("done parallel gate");
-  while (!this->executingGates.empty()) {
-    // pop gate
-    auto g = this->executingGates.front();
-    this->executingGates.pop_front();
-    // OPENFHE_DEBUG("execute gate" <<g.name);
-    // process gate
-    // g.Evaluate(this->plaintext_flag, this->encrypted_flag,
-    // this->verify_flag);
-    switch (g.op) {
-    case (GateEnum::INPUT):
-      this->n_input_gates++;
-      break;
-    case (GateEnum::OUTPUT):
-      this->n_output_gates++;
-      break;
-    case (GateEnum::NOT):
-      this->n_not_gates++;
-      break;
-    case (GateEnum::AND):
-      this->n_and_gates++;
-	  gates_now++;
-      break;
-    case (GateEnum::OR):
-      this->n_or_gates++;
-	  gates_now++;
-      break;
-    case (GateEnum::XOR):
-      this->n_xor_gates++;
-	  gates_now++;
-      break;
-    case (GateEnum::DFF):
-      break;
-    case (GateEnum::LUT3):
-      break;
-    case (GateEnum::LUT4):
-      break;
-    default:
-      std::cerr << "bad gate eval" << std::endl;
+  for (auto gid : batch) {
+    if (_RetireGate(gid)) {
+      gates_now++;
+    }
+  } // end for
+  OPENFHE_DEBUG("Execute done Cycle");
+  total_ex_time = TOC_MS(t_ex_tot);
+  std::cout << "Done" << std::endl;
+  if (total_ex_time == 0) {
+    total_ex_time = 1; // just in case it is zero
+  }
+  int n_proc = omp_get_max_threads();
+  std::cout << std::endl
+            << "Processing: " << gates_now << " of "
+            << this->ckt->allGates.size() << " " << ex_time << " ms/ "
+            << total_ex_time << " ms = " << ex_time / total_ex_time * 100.0
+            << " % eff" << std::endl
+            << "time/gate = " << ex_time / (float)gates_now << " ms "
+            << std::endl
+            << n_proc << " procs "
+            << (ex_time / (float)gates_now) * (float)n_proc
+            << " ms/gate (single proc est)" << std::endl;
+}
+
+void Circuit::_EvaluateGate(GateId gid, unsigned int lane) {
+  // evaluate one gate for one request lane reading its inputs from the
+  // wires, and drive its output wires (or output bit). the wires a gate
+  // touches are only touched by it at this point, so gates (and lanes)
+  // can be evaluated in parallel.
+  OPENFHE_DEBUG_FLAG(false);
+  const Gate &g = this->ckt->allGates[gid];
+  GateValues v;
+  auto n_in = g.inWires.size();
+  if (this->plaintext_flag) {
+    v.plainin.resize(n_in);
+  }
+  if (this->encrypted_flag) {
+    v.encin.resize(n_in);
+  }
+  for (size_t ix = 0; ix < n_in; ix++) {
+    const Wire &inw = this->state.wire(g.inWires[ix], lane);
+    if (this->plaintext_flag) {
+      v.plainin[ix] = inw.getValue();
+    }
+    if (this->encrypted_flag) {
+      v.encin[ix] = this->state.readCipherText(g.inWires[ix], lane);
     }
+  }
 
-    if (g.op != GateEnum::OUTPUT) { // output gates do not generate output wires
-      auto outnames = g.outWireNames;
-      unsigned int out_ix(0);
-      for (auto outname : outnames) {
-        OPENFHE_DEBUG("  activating gate " << g.name << " output wire "
-                                           << outname);
-
-        Wire w;
-        w.setName(outname);
-        if (this->plaintext_flag) {
-          w.setValue(g.plainout[out_ix]);
-        }
-        if (this->encrypted_flag) {
-          w.setCipherText(g.encout[out_ix]);
-        }
-        out_ix++;
+  g.Evaluate(this->gep, v);
 
-        // find fanout
-        auto it = this->nl.find(outname);
-        if (it == this->nl.end()) {
-          std::cerr << "error, could not find " << outname << " in netlist"
-                    << std::endl;
-        }
-        // std::cout<<"found "<<it->first<<std::endl;
-        // for (auto it: it->second){
-        //	std::cout<<" "<<it;
-        //}
-        // std::cout<<std::endl;
-
-        w.setFanoutGates(it->second);
-		
-        // remove from wire name from watitingWire list
-        auto oit = std::find(this->waitingWireNames.begin(),
-                             this->waitingWireNames.end(), outname);
-        if (oit == this->waitingWireNames.end()) {
-          std::cerr << "error can't find wire in waitingWireList in SetInput()"
-                    << std::endl;
-        }
-        this->waitingWireNames.erase(oit);
+  if (g.op != GateEnum::OUTPUT) { // output gates do not generate output wires
+    unsigned int out_ix(0);
+    for (auto outId : g.outWires) {
+      OPENFHE_DEBUG("  setting gate " << g.getName() << " output wire "
+                                      << _wire_name(outId));
 
-        // push onto activeWires queue
-        this->activeWires.push_back(w);
-        OPENFHE_DEBUG("  pushed onto active queue size" << activeWires.size());
-      } // for outnames
+      Wire &w = this->state.wire(outId, lane);
+      if (this->plaintext_flag) {
+        w.setValue(v.plainout[out_ix]);
+      }
+      if (this->encrypted_flag) {
+        this->state.holdCipherText(*this->ckt, outId, lane, v.encout[out_ix]);
+      }
+      out_ix++;
+    } // for outnames
+  } else {
+    // gate is output
+    // right now outputs are output, bit, and single value
+    if (encrypted_flag) {
+      // decrypted with all other outputs in _DecryptOutputs()
+      this->state.circuitOutCt[lane][g.ioBus][g.ioBit] = v.encout[0];
     } else {
-      // gate is output
-      // right now outputs are output, bit, and single value
-      if (encrypted_flag) {
-        lbcrypto::LWEPlaintext res;
-        this->cc.Decrypt(this->sk, g.encout[0], &res);
-        _parse_output(g.outWireNames[0], g.outWireNames[1], res);
-      } else {
-        if (!plaintext_flag) {
-          std::cerr << "Error either encrypted or plaintext flag must be set"
-                    << std::endl;
+      if (!plaintext_flag) {
+        std::cerr << "Error either encrypted or plaintext flag must be set"
+                  << std::endl;
+      }
+      this->state.circuitOut[lane][g.ioBus][g.ioBit] = v.plainout[0];
+    }
+  } // if gate is not OUTPUT
+}
+
+bool Circuit::_RetireGate(GateId gid) {
+  // count an evaluated gate, and push its output wires onto the active
+  // wire queue.
+  // returns true if the gate needed a bootstrap
+  OPENFHE_DEBUG_FLAG(false);
+  const Gate &g = this->ckt->allGates[gid];
+  bool bootstrapped = _CountGate(g.op);
+
+  for (auto outId : g.outWires) {
+    // mark the wire driven
+    if (!this->state.driveWire(outId)) {
+      std::cerr << "error wire " << _wire_name(outId)
+                << " driven twice in _RetireGate()" << std::endl;
+    }
+
+    // push onto activeWires queue
+    this->state.activeWires.push_back(outId);
+    OPENFHE_DEBUG("  pushed onto active queue size"
+                  << this->state.activeWires.size());
+  } // for outnames
+
+  OPENFHE_DEBUG("  gate " << g.getName() << " done");
+  this->state.n_done++; // done with this gate
+  return bootstrapped;
+}
+
+bool Circuit::_CountGate(GateEnum op) {
+  // count an evaluated gate, returns true if it needed a bootstrap
+  switch (op) {
+  case (GateEnum::INPUT):
+    this->state.n_input_gates++;
+    break;
+  case (GateEnum::OUTPUT):
+    this->state.n_output_gates++;
+    break;
+  case (GateEnum::NOT):
+    this->state.n_not_gates++;
+    break;
+  case (GateEnum::AND):
+  case (GateEnum::NAND):
+    this->state.n_and_gates++;
+    break;
+  case (GateEnum::OR):
+  case (GateEnum::NOR):
+    this->state.n_or_gates++;
+    break;
+  case (GateEnum::XOR):
+  case (GateEnum::XNOR):
+    this->state.n_xor_gates++;
+    break;
+  case (GateEnum::AND3):
+  case (GateEnum::OR3):
+  case (GateEnum::MAJORITY):
+    this->state.n_multi_gates++;
+    break;
+  case (GateEnum::DFF):
+    break;
+  case (GateEnum::LUT3):
+  case (GateEnum::LUT4):
+    this->state.n_lut_gates++;
+    break;
+  default:
+    std::cerr << "bad gate eval" << std::endl;
+  }
+  return GateBootstraps(op) > 0;
+}
+
+void Circuit::_ExecuteBitSliced(void) {
+  // evaluate the inputs given to SetInput() with the bit sliced engine,
+  // and count the gates as if they had been evaluated one by one
+  this->state.circuitOut = _PlainEngine()->Evaluate(this->plainInputs);
+  for (const auto &g : this->ckt->allGates) {
+    _CountGate(g.op);
+  }
+  this->state.n_done = this->ckt->allGates.size();
+}
+
+std::shared_ptr<const BitSliceEngine> Circuit::_PlainEngine(void) {
+  // built on first use, Load() drops it
+  if (this->plainEngine == nullptr) {
+    this->plainEngine = std::make_shared<const BitSliceEngine>(this->ckt);
+  }
+  return this->plainEngine;
+}
+
+std::vector<Outputs>
+Circuit::EvaluatePlaintext(const std::vector<Inputs> &batch) {
+  TIC(auto t_batch);
+  auto outputs = _PlainEngine()->Evaluate(batch);
+  std::cout << "### Bit sliced time " << TOC_MS(t_batch) << " msec for "
+            << batch.size() << " vectors, "
+            << BitSliceEngine::VectorsPerPass() << " per pass" << std::endl;
+  return outputs;
+}
+
+void Circuit::_DecryptOutputs(void) {
+  // decrypt all output bits of all requests in parallel once the
+  // circuit is done
+  const auto &outputGates = this->ckt->outputGates;
+  unsigned int lanes = this->state.lanes;
+  size_t n_work = outputGates.size() * lanes;
+#pragma omp parallel for
+  for (size_t k = 0; k < n_work; k++) {
+    unsigned int lane = k % lanes;
+    const Gate &g = this->ckt->allGates[outputGates[k / lanes]];
+    auto &ct = this->state.circuitOutCt[lane][g.ioBus][g.ioBit];
+    if (ct == nullptr) {
+      continue; // output gate was never evaluated
+    }
+    lbcrypto::LWEPlaintext res;
+    this->keys->cc.Decrypt(this->keys->sk, ct, &res,
+                           this->ckt->plaintextModulus);
+    this->state.circuitOut[lane][g.ioBus][g.ioBit] = res;
+    ct = nullptr; // last use, free it
+
+  }
+}
+
+void Circuit::_ExecuteDataflow(void) {
+  // dataflow execution: every thread pulls a ready gate from the shared
+  // ready gate queue, evaluates it, then retires it and pushes any
+  // consumer gate whose last input just arrived back on the queue. there
+  // is no barrier between circuit levels, so narrow levels do not leave
+  // threads idle while the slowest gate of the level finishes.
+  // gate evaluation runs unlocked, all queue and netlist bookkeeping is
+  // done under one lock (it is tiny compared to a bootstrap).
+  // with a batch of requests the gate taken from the queue is fanned out,
+  // the next `lanes` work items are its lanes, and it is retired
+  // when its last lane is done.
+  OPENFHE_DEBUG_FLAG(false);
+  std::mutex mtx;
+  std::condition_variable cv;
+
+  // seed the ready queue with gates driven only by circuit inputs
+  _PropagateWires();
+  size_t n_left = this->ckt->allGates.size() - this->state.n_done;
+  unsigned int n_busy = 0; // threads currently evaluating a gate
+  bool stalled = false;
+  const unsigned int lanes = this->state.lanes;
+  GateId fan_gate = 0;           // gate whose lanes are being handed out
+  unsigned int fan_next = lanes; // next lane of fan_gate to hand out
+  std::vector<unsigned int> lanes_left(this->ckt->allGates.size());
+  // with a memory cap the ciphertexts that running gates will create are
+  // reserved when they start, and a gate is only started if it fits
+  size_t reserved = 0;
+  std::vector<size_t> reserved_by(this->maxLive ? lanes_left.size() : 0);
+  size_t creates = 0;
+  auto startable = [&] {
+    return !this->state.executingGates.empty() &&
+           ((this->maxLive == 0) || (n_busy == 0) ||
+            _FitsMemory(this->state.executingGates.top(), reserved,
+                        &creates));
+  };
+
+#pragma omp parallel
+  {
+    std::unique_lock<std::mutex> lock(mtx);
+    while (true) {
+      if ((fan_next >= lanes) && !this->state.executingGates.empty() &&
+          !startable()) {
+        this->n_held++; // this thread idles to respect the cap
+      }
+      cv.wait(lock, [&] {
+        return (fan_next < lanes) || startable() || (n_left == 0) ||
+               (n_busy == 0);
+      });
+      if (fan_next >= lanes) {
+        if (this->state.executingGates.empty()) {
+          if ((n_left != 0) && !stalled) {
+            // nothing ready, nothing running, but gates are left
+            stalled = true;
+            std::cerr << "error in dataflow execution: " << n_left
+                      << " gates can never become ready" << std::endl;
+          }
+          break;
+        }
+        if (this->maxLive) { // ciphertexts the gate about to start creates
+          _FitsMemory(this->state.executingGates.top(), reserved, &creates);
+        }
+        fan_gate = this->state.executingGates.pop();
+        fan_next = 0;
+        lanes_left[fan_gate] = lanes;
+        if (this->maxLive) {
+          reserved_by[fan_gate] = creates;
+          reserved += creates;
+        }
+      }
+      auto gid = fan_gate;
+      auto lane = fan_next++;
+      n_busy++;
+      lock.unlock();
+
+      OPENFHE_DEBUG("processing gate " << gid << " lane " << lane);
+      TIC(auto t_gate);
+      _EvaluateGate(gid, lane);
+      uint64_t gate_us = TOC_US(t_gate);
+
+      lock.lock();
+      TIC(auto t_mgt);
+      this->busy_us += gate_us;
+      if (--lanes_left[gid] == 0) {
+        if (this->maxLive) {
+          reserved -= reserved_by[gid]; // now counted as live
         }
-        _parse_output(g.outWireNames[0], g.outWireNames[1], g.plainout[0]);
+        _RetireGate(gid);
+        _PropagateWires();
+        n_left--;
       }
-    } // if gate is not OUTPUT
+      n_busy--;
+      this->mgt_us += TOC_US(t_mgt);
+      cv.notify_all();
+    }
+  }
+  std::cout << "Done" << std::endl;
+}
 
-    OPENFHE_DEBUG("  gate " << g.name << " done");
-    this->doneGates.push_back(g); // done with this gate
-  }                               // end while
-  OPENFHE_DEBUG("Execute done Cycle");
-  total_ex_time = TOC_MS(t_ex_tot);
-  std::cout << "Done"<<std::endl;
-  if (total_ex_time == 0) {
-	total_ex_time = 1; //just in case it is zero
+bool Circuit::_FitsMemory(GateId gid, size_t reserved, size_t *creates) {
+  // true if starting gate gid keeps the live ciphertexts within the cap,
+  // or if it frees at least as many ciphertexts as it creates in every
+  // lane. sets *creates to the ciphertexts it will create over all lanes.
+  const Gate &g = this->ckt->allGates[gid];
+  size_t n_create = 0;
+  for (auto ow : g.outWires) {
+    n_create += !this->ckt->nl[ow].empty();
+  }
+  // the least freed in any lane: in dataflow mode the lanes of a reader
+  // run on different threads, so one lane of a wire may be freed while
+  // another is still held
+  size_t n_free = g.inWires.size();
+  for (unsigned int lane = 0; lane < this->state.lanes; lane++) {
+    size_t n_lane = 0;
+    for (auto it = g.inWires.begin(); it != g.inWires.end(); ++it) {
+      if (std::find(g.inWires.begin(), it, *it) != it) {
+        continue; // wire read twice, already counted
+      }
+      // the last reader frees the wire
+      n_lane += (this->state.readsLeft(*it, lane) ==
+                 std::count(g.inWires.begin(), g.inWires.end(), *it));
+    }
+    n_free = std::min(n_free, n_lane);
+  }
+  *creates = n_create * this->state.lanes;
+  if (n_create <= n_free) {
+    return true;
   }
-  int n_proc =omp_get_max_threads(); 
-  std::cout << std::endl << "Processing: " << gates_now << " of "
-            << this->allGates.size() << " "<< ex_time << " ms/ "
-			<< total_ex_time << " ms = "
-			<< ex_time / total_ex_time * 100.0 << " % eff" << std::endl
-			<< "time/gate = "<< ex_time / (float) gates_now << " ms " <<std::endl
-	        << n_proc << " procs "<< (ex_time / (float) gates_now) * (float) n_proc
-			<< " ms/gate (single proc est)"
-			<< std::endl;
-  
+  size_t live;
+#pragma omp atomic read
+  live = this->state.liveCipherTexts;
+  return live + reserved + *creates <= this->maxLive;
 }
 
 void Circuit::setPlaintext(bool input) {
@@ -867,33 +1176,102 @@ void Circuit::setVerify(bool input) {
 
 bool Circuit::getVerify(void) { return (this->verify_flag); }
 
+void Circuit::setDataflow(bool input) { this->dataflow_flag = input; }
+
+bool Circuit::getDataflow(void) { return (this->dataflow_flag); }
+
+void Circuit::setPriority(bool input) {
+  this->priority_flag = input;
+  // with a memory cap, gates that free ciphertexts go first
+  const auto &table =
+      this->maxLive ? this->ckt->memoryPriority : this->ckt->gateHeight;
+  this->state.executingGates.setPriority(input ? &table : nullptr);
+}
+
+bool Circuit::getPriority(void) { return (this->priority_flag); }
+
+void Circuit::setMaxLive(size_t input) {
+  this->maxLive = input;
+  this->setPriority(this->priority_flag); // pick the matching queue order
+}
+
+size_t Circuit::getMaxLive(void) { return (this->maxLive); }
+
+void Circuit::setTechMap(bool input) { this->techmap_flag = input; }
+
+bool Circuit::getTechMap(void) { return (this->techmap_flag); }
+
+void Circuit::setPushNots(bool input) { this->pushnots_flag = input; }
+
+bool Circuit::getPushNots(void) { return (this->pushnots_flag); }
+
+void Circuit::setOptimize(bool input) { this->optimize_flag = input; }
+
+bool Circuit::getOptimize(void) { return (this->optimize_flag); }
+
+void Circuit::setRebalance(bool input) { this->rebalance_flag = input; }
+
+bool Circuit::getRebalance(void) { return (this->rebalance_flag); }
+
+void Circuit::setLutMap(unsigned int k) { this->lutInputs = k; }
+
+unsigned int Circuit::getLutMap(void) { return (this->lutInputs); }
+
+void Circuit::setConstantInput(unsigned int bus, unsigned int bit,
+                               unsigned int value) {
+  this->constantInputs[{bus, bit}] = value & 1;
+}
+
+void Circuit::setOptions(const CircuitOptions &opts) {
+  this->setDataflow(opts.dataflow);
+  this->setPriority(!opts.fifo);
+  this->setMaxLive(opts.maxLive);
+  this->setTechMap(opts.techMap);
+  this->setPushNots(opts.pushNots);
+  this->setOptimize(opts.optimize);
+  this->setRebalance(opts.rebalance);
+  this->setLutMap(opts.lutInputs);
+}
+
+void Circuit::setKeepNames(bool input) { this->names_flag = input; }
+
 void Circuit::dumpNetList(void) {
   std::cout << "Netlist " << std::endl;
-  for (auto it : this->nl) {
-    std::cout << it.first;
+  for (WireId w = 0; w < this->ckt->nl.size(); w++) {
+    std::cout << _wire_name(w);
 
-    for (auto it2 : it.second) {
-      std::cout << " " << it2;
+    for (auto gid : this->ckt->nl[w]) {
+      std::cout << " " << this->ckt->allGates[gid].getName();
     }
     std::cout << std::endl;
   }
 }
 void Circuit::dumpGates(void) {
   std::cout << "Inputlist " << std::endl;
-  for (auto it : this->inputGates) {
-    std::cout << it.name << std::endl;
+  for (const auto &it : this->ckt->inputGates) {
+    std::cout << it.getName() << std::endl;
   }
   std::cout << "Alllist " << std::endl;
-  for (auto it : this->allGates) {
-    std::cout << it.name << std::endl;
+  for (const auto &it : this->ckt->allGates) {
+    std::cout << it.getName() << std::endl;
   }
 }
 
 void Circuit::dumpGateCount(void) {
-  std::cout << "Number of input gates " << this->n_input_gates << std::endl;
-  std::cout << "Number of output gates " << this->n_output_gates << std::endl;
-  std::cout << "Number of not gates " << this->n_not_gates << std::endl;
-  std::cout << "Number of and gates " << this->n_and_gates << std::endl;
-  std::cout << "Number of or gates " << this->n_or_gates << std::endl;
-  std::cout << "Number of xor gates " << this->n_xor_gates << std::endl;
+  std::cout << "Number of input gates " << this->state.n_input_gates
+            << std::endl;
+  std::cout << "Number of output gates " << this->state.n_output_gates
+            << std::endl;
+  std::cout << "Number of not gates " << this->state.n_not_gates
+            << std::endl;
+  std::cout << "Number of and gates " << this->state.n_and_gates
+            << std::endl;
+  std::cout << "Number of or gates " << this->state.n_or_gates
+            << std::endl;
+  std::cout << "Number of xor gates " << this->state.n_xor_gates
+            << std::endl;
+  std::cout << "Number of 3 input gates " << this->state.n_multi_gates
+            << std::endl;
+  std::cout << "Number of LUT gates " << this->state.n_lut_gates
+            << std::endl;
 }
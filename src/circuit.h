@@ -39,25 +39,54 @@
 #include <deque>
 #include <string>
 #include <vector>
+#include <memory>
 #include <omp.h>
+#include "analyze.h"
+#include "bitslice.h"
+#include "compiled.h"
 #include "gate.h"
+#include "rewrite.h"
+#include "keys.h"
+#include "schedule.h"
 #include "wire.h"
 
-using GateNameList = std::vector<std::string>;
-using GateList = std::vector<Gate>;
-using GateQueue = std::deque<Gate>;
-
-using Inputs = std::vector<std::vector<unsigned int>>;
-using Outputs = std::vector<std::vector<unsigned int>>;
-using NetList = std::unordered_map<std::string, GateNameList>;
+// evaluation engine settings, usually set from the command line
+class CircuitOptions {
+public:
+  bool dataflow = false; // barrier free dataflow execution of gates
+  bool fifo = false;     // FIFO ready queue instead of critical path first
+  std::string keyDir;    // key store directory, empty to generate keys
+  size_t maxLive = 0;    // cap on live ciphertexts, 0 for no cap
+  bool techMap = false;  // map onto three input gates, see techmap.h
+  bool pushNots = false; // fold NOT gates into their neighbours
+  bool optimize = false; // fold constants, merge equal gates, drop dead ones
+  bool rebalance = false; // rebuild AND and XOR chains as balanced trees
+  unsigned int lutInputs = 0; // map onto LUT gates of 3 or 4 inputs, 0 not
+};
 
 class Circuit {
 public:
   Circuit(lbcrypto::BINFHE_PARAMSET set, lbcrypto::BINFHE_METHOD method);
+  // use an existing, possibly shared, key set, e.g. from GetKeySet()
+  explicit Circuit(KeySetPtr keys);
   ~Circuit();
   bool ReadFile(std::string cktName);
+  // build the circuit straight from a Bristol file (old or new format),
+  // or from its analysis, without an assembled .out listing
+  bool ReadBristol(std::string bristolName, bool new_flag);
+  void Load(const Analysis &);
+  // save the loaded circuit as a binary compiled circuit, and read one
+  // back. much faster to start from than parsing a text circuit.
+  void SaveCompiled(std::string fname);
+  bool ReadCompiled(std::string fname);
+  // evaluate an already compiled circuit, it can be shared by any number
+  // of Circuit objects running at the same time on different threads
+  void Load(std::shared_ptr<const CompiledCircuit>);
+  std::shared_ptr<const CompiledCircuit> getCompiled(void);
   void Reset(void);
   void SetInput(Inputs input, bool verbose = false);
+  // a batch of independent requests, evaluated over one schedule
+  void SetInput(const std::vector<Inputs> &batch, bool verbose = false);
   std::string Evaluate(void);
   void setPlaintext(bool);
   bool getPlaintext(void);
@@ -65,52 +94,103 @@ public:
   bool getEncrypted(void);
   void setVerify(bool);
   bool getVerify(void);
+  void setKeepNames(bool); // keep wire names for dump*(), set before ReadFile
+  void setDataflow(bool);
+  bool getDataflow(void);
+  void setPriority(bool); // if false dispatch ready gates in FIFO order
+  bool getPriority(void);
+  // memory bounded schedule: at most this many ciphertexts live at once
+  // (when it can be met), 0 for no cap. runs the dataflow executor.
+  void setMaxLive(size_t);
+  size_t getMaxLive(void);
+  // rewrite circuits onto AND3, OR3 and MAJORITY gates as they are
+  // loaded. set before ReadFile, needs a parameter set with 3 input gates
+  void setTechMap(bool);
+  bool getTechMap(void);
+  // fold NOT gates into neighbouring gates as circuits are loaded (see
+  // rewrite.h), set before ReadFile
+  void setPushNots(bool);
+  bool getPushNots(void);
+  // fold constant inputs, merge equal gates and drop gates that reach no
+  // output as circuits are loaded (see rewrite.h), set before ReadFile.
+  // setConstantInput() declares an input bit that is always value, the
+  // input stays and SetInput() must still give it that value.
+  void setOptimize(bool);
+  bool getOptimize(void);
+  void setConstantInput(unsigned int bus, unsigned int bit,
+                        unsigned int value);
+  // rebuild chains of AND and XOR gates as balanced trees as circuits are
+  // loaded, to shorten the critical path (see rewrite.h)
+  void setRebalance(bool);
+  bool getRebalance(void);
+  // map circuits onto LUT gates of at most k (3 or 4) inputs as they are
+  // loaded (see lutmap.h), 0 for none. the key set must be made for the
+  // same k (GetKeySet() with lutInputs).
+  void setLutMap(unsigned int k);
+  unsigned int getLutMap(void);
+  void setOptions(const CircuitOptions &);
   Outputs Clock(void);
+  std::vector<Outputs> ClockBatch(void); // one Outputs per request
+  // gate level steps, for callers that schedule the gates of one request
+  // themselves (see CircuitStream). after SetInput(), ReadyGates() hands
+  // out the gates whose inputs have all arrived. EvaluateGate() may run
+  // on any thread, RetireGate() must not run concurrently with any other
+  // step and makes the gate's consumers ready. once GatesLeft() is 0,
+  // DecryptOutputs() returns one Outputs per request.
+  std::vector<GateId> ReadyGates(void);
+  void EvaluateGate(GateId, unsigned int lane = 0);
+  void RetireGate(GateId);
+  size_t GatesLeft(void);
+  std::vector<Outputs> DecryptOutputs(void);
+  // evaluate many plaintext input vectors at once, bit sliced
+  std::vector<Outputs> EvaluatePlaintext(const std::vector<Inputs> &batch);
 
   void dumpNetList(void);
   void dumpGates(void);
   void dumpGateCount(void);
 
 private:
-  lbcrypto::BinFHEContext cc;
-  lbcrypto::LWEPrivateKey sk;
+  KeySetPtr keys; // crypto context and keys, shared with other Circuits
 
   bool plaintext_flag; // if true perform plaintext logic
   bool encrypted_flag; // if true perform encrypted logic
   bool verify_flag;    // if true verify plaintext vs encrypted logic
-
-  NetList nl; // full net list of the ckt (all wires and fanout gates)
-
-  WireNameList waitingWireNames;
-  WireQueue activeWires;
-
-  GateList inputGates; // input gates in ckt
-  GateList allGates;   // all other gates in ckt
-
-  GateQueue readyGates;
-  GateQueue waitingGates;
-  GateQueue executingGates;
-  GateQueue examinedGates;
-  GateQueue doneGates;
+  bool names_flag;     // if true keep the wire name side table
+  bool dataflow_flag;  // if true execute gates as a dataflow graph
+  bool techmap_flag;   // if true map loaded circuits onto 3 input gates
+  bool pushnots_flag;  // if true fold NOT gates into their neighbours
+  bool optimize_flag;  // if true optimize loaded circuits
+  bool rebalance_flag; // if true rebalance loaded circuits
+  unsigned int lutInputs; // LUT map loaded circuits onto this many inputs
+  ConstantInputs constantInputs; // input bits declared constant
+
+  std::shared_ptr<const CompiledCircuit> ckt; // read only circuit
+  EvaluationState state;                       // this Circuit's evaluation
+  bool priority_flag; // if true dispatch critical path first
+  size_t maxLive;     // cap on live ciphertexts, 0 for no cap
+  size_t n_held;      // times a ready gate was held back by the cap
   bool done;
+  std::shared_ptr<const BitSliceEngine> plainEngine; // built on first use
+  std::vector<Inputs> plainInputs; // last SetInput(), for bit slicing
 
-  bool _parse_input(Inputs, std::string, std::string);
-  void _parse_output(std::string, std::string, bool);
+  std::string _wire_name(WireId);
   void _CircuitManager(void);
+  unsigned int _PropagateWires(void);
   void _ExecuteGates(void);
+  void _EvaluateGate(GateId, unsigned int lane);
+  bool _RetireGate(GateId);
+  void _ExecuteDataflow(void);
+  bool _FitsMemory(GateId, size_t reserved, size_t *creates);
+  void _DecryptOutputs(void);
+  bool _CountGate(GateEnum);
+  void _ExecuteBitSliced(void);
+  std::shared_ptr<const BitSliceEngine> _PlainEngine(void);
 
   GateEvalParams gep;
 
-  unsigned int n_outputs;
-  std::vector<unsigned int> n_output_bits;
-  Outputs circuitOut;
-
-  unsigned int n_input_gates;
-  unsigned int n_output_gates;
-  unsigned int n_and_gates;
-  unsigned int n_or_gates;
-  unsigned int n_xor_gates;
-  unsigned int n_not_gates;
+  uint64_t busy_us; // thread time spent evaluating gates in Clock()
+  uint64_t mgt_us;  // time spent managing gates in dataflow mode
+  uint64_t encrypt_ms; // time spent encrypting inputs in SetInput()
 };
 
 #endif
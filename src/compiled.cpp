@@ -0,0 +1,600 @@
+// @file compiled.cpp -- compiled circuit and per evaluation state objects
+//==================================================================================
+// BSD 2-Clause License
+//
+// Copyright (c) 2014-2022, NJIT, Duality Technologies Inc. and other
+// contributors
+//
+// All rights reserved.
+//
+// Author TPOC: contact@openfhe.org
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//==================================================================================
+#include "compiled.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// compiled circuit file, a header followed by arrays of 32 bit words:
+//   n_output_bits             [n_outputs]
+//   n_input_bits              [n_in_buses]
+//   input gates ioBus, ioBit, outWire   [3 * n_inputs]
+//   gates op, ioBus, ioBit, truthTable  [4 * n_gates]
+//   gate input wire offsets   [n_gates + 1], input wires  [n_gate_in]
+//   gate output wire offsets  [n_gates + 1], output wires [n_gate_out]
+//   netlist reader offsets    [n_wires + 1], reader gates [n_readers]
+//   gateHeight                [n_gates]
+//   memoryPriority            [n_gates]
+// gates are in program order, so the gate array is topologically sorted.
+// words are in host byte order, a byte swapped file fails the magic check.
+static const uint32_t COMPILED_MAGIC = 0x4343454f; // "OECC"
+static const uint32_t COMPILED_VERSION = 4;
+
+// header flags, the passes a circuit was already rewritten by
+static const uint32_t COMPILED_TECHMAPPED = 1;
+static const uint32_t COMPILED_INVERSIONS_PUSHED = 2;
+static const uint32_t COMPILED_OPTIMIZED = 4;
+static const uint32_t COMPILED_REBALANCED = 8;
+static const uint32_t COMPILED_LUTMAPPED = 16;
+
+struct CompiledFileHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t n_wires;
+  uint32_t n_inputs;
+  uint32_t n_gates;
+  uint32_t n_outputs;
+  uint32_t n_gate_in;
+  uint32_t n_gate_out;
+  uint32_t n_readers;
+  uint32_t criticalPath;
+  uint32_t flags;
+  uint32_t n_in_buses;
+};
+
+CompiledCircuit::CompiledCircuit(void)
+    : keepNames(false), criticalPath(0), techMapped(false),
+      inversionsPushed(false), optimized(false),
+      rebalanced(false), lutMapped(false), plaintextModulus(4),
+      n_outputs(0) {}
+
+CompiledCircuit::~CompiledCircuit(void) {}
+
+WireId CompiledCircuit::addWire(const std::string &name) {
+  WireId w = this->nl.size();
+  this->nl.emplace_back();
+  if (this->keepNames) {
+    this->wireNames.push_back(name);
+  }
+  return w;
+}
+
+GateId CompiledCircuit::addGate(Gate g) {
+  // index each gate by the wires it consumes as it is added, so the
+  // netlist is built in one linear pass over the circuit.
+  GateList &gl =
+      (g.op == GateEnum::INPUT) ? this->inputGates : this->allGates;
+  g.id = gl.size();
+  if (g.op != GateEnum::INPUT) {
+    for (const auto &iw : g.inWires) {
+      this->nl[iw].push_back(g.id);
+    }
+  }
+  if (g.op == GateEnum::OUTPUT) {
+    this->outputGates.push_back(g.id);
+  }
+  gl.push_back(std::move(g));
+  return gl.back().id;
+}
+
+void CompiledCircuit::setOutputBits(std::vector<unsigned int> bits) {
+  this->n_outputs = bits.size();
+  this->n_output_bits = std::move(bits);
+}
+
+void CompiledCircuit::copyPassFlags(const CompiledCircuit &from) {
+  this->techMapped = from.techMapped;
+  this->inversionsPushed = from.inversionsPushed;
+  this->optimized = from.optimized;
+  this->rebalanced = from.rebalanced;
+  this->lutMapped = from.lutMapped;
+}
+
+void CompiledCircuit::finalize(void) {
+  // gates are stored in program order, so every consumer of a gate's
+  // outputs comes after it. one reverse pass gives each gate the number
+  // of bootstraps on its longest path to an output.
+  this->gateHeight.assign(this->allGates.size(), 0);
+  this->criticalPath = 0;
+  for (auto g = this->allGates.rbegin(); g != this->allGates.rend(); ++g) {
+    unsigned int h = 0;
+    for (auto ow : g->outWires) {
+      for (auto c : this->nl[ow]) {
+        h = std::max(h, this->gateHeight[c]);
+      }
+    }
+    h += GateBootstraps(g->op);
+    this->gateHeight[g->id] = h;
+    this->plaintextModulus =
+        std::max(this->plaintextModulus, GatePlaintextModulus(g->op));
+    this->criticalPath = std::max(this->criticalPath, h);
+  }
+  // the input buses are as wide as their highest bit
+  this->n_input_bits.clear();
+  for (const auto &g : this->inputGates) {
+    if (g.ioBus >= this->n_input_bits.size()) {
+      this->n_input_bits.resize(g.ioBus + 1, 0);
+    }
+    this->n_input_bits[g.ioBus] =
+        std::max(this->n_input_bits[g.ioBus], g.ioBit + 1);
+  }
+  // a gate that is the only reader of an input wire frees its ciphertext,
+  // each read output wire creates one. the gain is offset by the most
+  // created by any gate, so it is never negative
+  std::vector<int> gains(this->allGates.size(), 0);
+  int max_creates = 0;
+  for (const auto &g : this->allGates) {
+    int creates = 0;
+    for (auto iw : g.inWires) {
+      gains[g.id] += (this->nl[iw].size() == 1);
+    }
+    for (auto ow : g.outWires) {
+      creates += !this->nl[ow].empty();
+    }
+    gains[g.id] -= creates;
+    max_creates = std::max(max_creates, creates);
+  }
+  this->memoryPriority.assign(this->allGates.size(), 0);
+  for (const auto &g : this->allGates) {
+    unsigned int gain = gains[g.id] + max_creates;
+    this->memoryPriority[g.id] =
+        gain * (this->criticalPath + 1) + this->gateHeight[g.id];
+  }
+  std::cout << "netlist has " << this->nl.size() << " wires" << std::endl;
+  std::cout << "critical path " << this->criticalPath << " bootstraps"
+            << std::endl;
+}
+
+void CompiledCircuit::Save(const std::string &fname) const {
+  CompiledFileHeader h{};
+  h.magic = COMPILED_MAGIC;
+  h.version = COMPILED_VERSION;
+  h.n_wires = this->nl.size();
+  h.n_inputs = this->inputGates.size();
+  h.n_gates = this->allGates.size();
+  h.n_outputs = this->n_outputs;
+  h.n_in_buses = this->n_input_bits.size();
+  h.criticalPath = this->criticalPath;
+  h.flags = (this->techMapped ? COMPILED_TECHMAPPED : 0) |
+            (this->inversionsPushed ? COMPILED_INVERSIONS_PUSHED : 0) |
+            (this->optimized ? COMPILED_OPTIMIZED : 0) |
+            (this->rebalanced ? COMPILED_REBALANCED : 0) |
+            (this->lutMapped ? COMPILED_LUTMAPPED : 0);
+
+  std::vector<uint32_t> words(this->n_output_bits);
+  words.insert(words.end(), this->n_input_bits.begin(),
+               this->n_input_bits.end());
+  for (const auto &g : this->inputGates) {
+    words.insert(words.end(), {g.ioBus, g.ioBit, g.outWires[0]});
+  }
+  for (const auto &g : this->allGates) {
+    words.insert(words.end(),
+                 {uint32_t(g.op), g.ioBus, g.ioBit, g.truthTable});
+  }
+  // each variable length list as offsets plus one flat array
+  auto csr = [&words](size_t n, auto list, uint32_t *total) {
+    uint32_t offset = 0;
+    for (size_t ix = 0; ix < n; ix++) {
+      words.push_back(offset);
+      offset += list(ix).size();
+    }
+    words.push_back(offset);
+    for (size_t ix = 0; ix < n; ix++) {
+      words.insert(words.end(), list(ix).begin(), list(ix).end());
+    }
+    *total = offset;
+  };
+  csr(h.n_gates, [this](size_t g) -> const WireIdList & {
+    return this->allGates[g].inWires;
+  }, &h.n_gate_in);
+  csr(h.n_gates, [this](size_t g) -> const WireIdList & {
+    return this->allGates[g].outWires;
+  }, &h.n_gate_out);
+  csr(h.n_wires, [this](size_t w) -> const GateIdList & {
+    return this->nl[w];
+  }, &h.n_readers);
+  words.insert(words.end(), this->gateHeight.begin(), this->gateHeight.end());
+  words.insert(words.end(), this->memoryPriority.begin(),
+               this->memoryPriority.end());
+
+  std::ofstream out(fname, std::ios::binary);
+  out.write(reinterpret_cast<const char *>(&h), sizeof h);
+  out.write(reinterpret_cast<const char *>(words.data()),
+            words.size() * sizeof(uint32_t));
+  if (!out) {
+    std::cerr << "error writing compiled circuit " << fname << ".. exiting!"
+              << std::endl;
+    exit(-1);
+  }
+  std::cout << "saved compiled circuit " << fname << std::endl;
+}
+
+// number of input wires a gate of this kind reads is right
+static bool _InputCountOk(GateEnum op, size_t n) {
+  switch (op) {
+  case (GateEnum::OUTPUT):
+  case (GateEnum::NOT):
+    return n == 1;
+  case (GateEnum::AND):
+  case (GateEnum::OR):
+  case (GateEnum::XOR):
+  case (GateEnum::NAND):
+  case (GateEnum::NOR):
+  case (GateEnum::XNOR):
+    return n == 2;
+  case (GateEnum::AND3):
+  case (GateEnum::OR3):
+  case (GateEnum::MAJORITY):
+    return n == 3;
+  case (GateEnum::LUT3):
+    return (n >= 1) && (n <= 3);
+  case (GateEnum::LUT4):
+    return n == 4;
+  default: // INPUT is not in the gate array, DFF cannot be evaluated
+    return false;
+  }
+}
+
+std::shared_ptr<CompiledCircuit>
+CompiledCircuit::Map(const std::string &fname) {
+  int fd = open(fname.c_str(), O_RDONLY);
+  struct stat sb;
+  if ((fd < 0) || (fstat(fd, &sb) != 0)) {
+    std::cerr << "error opening compiled circuit " << fname << ".. exiting!"
+              << std::endl;
+    exit(-1);
+  }
+  size_t n_bytes = sb.st_size;
+  void *mapped = (n_bytes < sizeof(CompiledFileHeader))
+                     ? MAP_FAILED
+                     : mmap(nullptr, n_bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd); // the mapping stays valid
+  if (mapped == MAP_FAILED) {
+    std::cerr << "error mapping compiled circuit " << fname << ".. exiting!"
+              << std::endl;
+    exit(-1);
+  }
+  CompiledFileHeader h;
+  memcpy(&h, mapped, sizeof h);
+  // the header fixes the size of every array, check them all at once
+  size_t n_words = size_t(h.n_outputs) + size_t(h.n_in_buses) +
+                   3 * size_t(h.n_inputs) +
+                   4 * size_t(h.n_gates) + 2 * (size_t(h.n_gates) + 1) +
+                   h.n_gate_in + h.n_gate_out + (size_t(h.n_wires) + 1) +
+                   h.n_readers + 2 * size_t(h.n_gates);
+  if ((h.magic != COMPILED_MAGIC) || (h.version != COMPILED_VERSION) ||
+      (n_bytes != sizeof h + n_words * sizeof(uint32_t))) {
+    std::cerr << "bad compiled circuit " << fname << " (version " << h.version
+              << ").. exiting!" << std::endl;
+    exit(-1);
+  }
+  madvise(mapped, n_bytes, MADV_SEQUENTIAL);
+  const uint32_t *p = reinterpret_cast<const uint32_t *>(
+      static_cast<const char *>(mapped) + sizeof h);
+  auto take = [&p](size_t n) {
+    const uint32_t *section = p;
+    p += n;
+    return section;
+  };
+
+  // every id and offset in the file is used as an index, so a corrupt
+  // file must fail here rather than read or write out of bounds
+  auto bad = [&fname](const std::string &why) {
+    std::cerr << "bad compiled circuit " << fname << ", " << why
+              << ".. exiting!" << std::endl;
+    exit(-1);
+  };
+  auto checkOffsets = [&bad](const uint32_t *off, size_t n, size_t total) {
+    if (off[0] != 0) {
+      bad("offsets do not start at 0");
+    }
+    for (size_t ix = 0; ix < n; ix++) {
+      if (off[ix] > off[ix + 1]) {
+        bad("offsets decrease");
+      }
+    }
+    if (off[n] != total) {
+      bad("offsets do not end at the array size");
+    }
+  };
+  auto checkIds = [&bad](const uint32_t *ids, size_t n, size_t limit,
+                         const char *what) {
+    for (size_t ix = 0; ix < n; ix++) {
+      if (ids[ix] >= limit) {
+        bad(std::string(what) + " id out of range");
+      }
+    }
+  };
+
+  auto c = std::make_shared<CompiledCircuit>();
+  const uint32_t *bits = take(h.n_outputs);
+  c->setOutputBits(std::vector<unsigned int>(bits, bits + h.n_outputs));
+  // every input bit is set by exactly one input gate
+  const uint32_t *in_bits = take(h.n_in_buses);
+  c->n_input_bits.assign(in_bits, in_bits + h.n_in_buses);
+  std::vector<size_t> bus_start(h.n_in_buses + 1, 0);
+  for (size_t bus = 0; bus < h.n_in_buses; bus++) {
+    bus_start[bus + 1] = bus_start[bus] + in_bits[bus];
+  }
+  if (bus_start[h.n_in_buses] != h.n_inputs) {
+    bad("input widths do not match the input gates");
+  }
+  std::vector<bool> bit_set(h.n_inputs, false);
+  const uint32_t *in = take(3 * size_t(h.n_inputs));
+  c->inputGates.resize(h.n_inputs);
+  for (GateId g = 0; g < h.n_inputs; g++) {
+    Gate &gate = c->inputGates[g];
+    gate.id = g;
+    gate.op = GateEnum::INPUT;
+    gate.ioBus = in[3 * g];
+    gate.ioBit = in[3 * g + 1];
+    gate.outWires.assign(1, in[3 * g + 2]);
+    if (in[3 * g + 2] >= h.n_wires) {
+      bad("input wire id out of range");
+    }
+    if ((gate.ioBus >= h.n_in_buses) || (gate.ioBit >= in_bits[gate.ioBus]) ||
+        bit_set[bus_start[gate.ioBus] + gate.ioBit]) {
+      bad("input bit out of range or set twice");
+    }
+    bit_set[bus_start[gate.ioBus] + gate.ioBit] = true;
+  }
+  const uint32_t *ops = take(4 * size_t(h.n_gates));
+  const uint32_t *in_off = take(size_t(h.n_gates) + 1);
+  const uint32_t *in_wires = take(h.n_gate_in);
+  const uint32_t *out_off = take(size_t(h.n_gates) + 1);
+  const uint32_t *out_wires = take(h.n_gate_out);
+  const uint32_t *nl_off = take(size_t(h.n_wires) + 1);
+  const uint32_t *readers = take(h.n_readers);
+  checkOffsets(in_off, h.n_gates, h.n_gate_in);
+  checkOffsets(out_off, h.n_gates, h.n_gate_out);
+  checkOffsets(nl_off, h.n_wires, h.n_readers);
+  checkIds(in_wires, h.n_gate_in, h.n_wires, "gate input wire");
+  checkIds(out_wires, h.n_gate_out, h.n_wires, "gate output wire");
+  checkIds(readers, h.n_readers, h.n_gates, "reader gate");
+  c->allGates.resize(h.n_gates);
+  for (GateId g = 0; g < h.n_gates; g++) {
+    Gate &gate = c->allGates[g];
+    gate.id = g;
+    if ((ops[4 * g] > uint32_t(GateEnum::XNOR)) || (ops[4 * g + 3] > 0xffff)) {
+      bad("bad gate op or truth table");
+    }
+    gate.op = GateEnum(ops[4 * g]);
+    gate.ioBus = ops[4 * g + 1];
+    gate.ioBit = ops[4 * g + 2];
+    gate.truthTable = ops[4 * g + 3];
+    c->plaintextModulus =
+        std::max(c->plaintextModulus, GatePlaintextModulus(gate.op));
+    gate.inWires.assign(in_wires + in_off[g], in_wires + in_off[g + 1]);
+    gate.outWires.assign(out_wires + out_off[g], out_wires + out_off[g + 1]);
+    if (!_InputCountOk(gate.op, gate.inWires.size()) ||
+        ((gate.op != GateEnum::OUTPUT) && gate.outWires.empty())) {
+      bad("wrong number of wires for " + gate.getName());
+    }
+    if (gate.op == GateEnum::OUTPUT) {
+      if ((gate.ioBus >= h.n_outputs) ||
+          (gate.ioBit >= c->n_output_bits[gate.ioBus])) {
+        bad("output bit out of range");
+      }
+      c->outputGates.push_back(g);
+    }
+  }
+  // the netlist must list each gate once for every input reading the
+  // wire, or the scheduler waits on inputs that never arrive (or counts
+  // past zero)
+  NetList expect(h.n_wires);
+  for (const auto &g : c->allGates) {
+    for (auto iw : g.inWires) {
+      expect[iw].push_back(g.id);
+    }
+  }
+  c->nl.resize(h.n_wires);
+  for (WireId w = 0; w < h.n_wires; w++) {
+    c->nl[w].assign(readers + nl_off[w], readers + nl_off[w + 1]);
+    GateIdList sorted = c->nl[w];
+    std::sort(sorted.begin(), sorted.end());
+    if (sorted != expect[w]) {
+      bad("netlist does not match the gate inputs");
+    }
+  }
+  const uint32_t *height = take(h.n_gates);
+  c->gateHeight.assign(height, height + h.n_gates);
+  const uint32_t *priority = take(h.n_gates);
+  c->memoryPriority.assign(priority, priority + h.n_gates);
+  c->criticalPath = h.criticalPath;
+  c->techMapped = (h.flags & COMPILED_TECHMAPPED) != 0;
+  c->inversionsPushed = (h.flags & COMPILED_INVERSIONS_PUSHED) != 0;
+  c->optimized = (h.flags & COMPILED_OPTIMIZED) != 0;
+  c->rebalanced = (h.flags & COMPILED_REBALANCED) != 0;
+  c->lutMapped = (h.flags & COMPILED_LUTMAPPED) != 0;
+  munmap(mapped, n_bytes);
+  return c;
+}
+
+std::string CompiledCircuit::wireName(WireId w) const {
+  if (w < this->wireNames.size()) {
+    return this->wireNames[w] + "(" + std::to_string(w) + ")";
+  }
+  return "W:" + std::to_string(w);
+}
+
+size_t CompiledCircuit::numberWires(void) const { return this->nl.size(); }
+
+EvaluationState::EvaluationState(void)
+    : lanes(1), n_done(0), liveCipherTexts(0), peakLiveCipherTexts(0),
+      n_input_gates(0), n_output_gates(0), n_and_gates(0), n_or_gates(0),
+      n_xor_gates(0), n_not_gates(0), n_multi_gates(0), n_lut_gates(0),
+      generation(0) {}
+
+EvaluationState::~EvaluationState(void) {}
+
+void EvaluationState::Init(const CompiledCircuit &ckt, unsigned int lanes) {
+  this->lanes = lanes;
+  this->wires.assign(ckt.numberWires() * lanes, Wire());
+  for (WireId w = 0; w < ckt.numberWires(); w++) {
+    for (unsigned int lane = 0; lane < lanes; lane++) {
+      this->wire(w, lane).setId(w);
+    }
+  }
+  this->pendingInputs.assign(ckt.allGates.size(), 0);
+  this->readersLeft.assign(ckt.numberWires() * lanes, 0);
+  this->gateGeneration.assign(ckt.allGates.size(), 0);
+  this->wireGeneration.assign(ckt.numberWires(), 0);
+  this->circuitOut.resize(lanes);
+  this->circuitOutCt.resize(lanes);
+  for (unsigned int lane = 0; lane < lanes; lane++) {
+    this->circuitOut[lane].resize(ckt.n_outputs);
+    this->circuitOutCt[lane].resize(ckt.n_outputs);
+    for (unsigned int ix = 0; ix < ckt.n_outputs; ix++) {
+      this->circuitOut[lane][ix].assign(ckt.n_output_bits[ix], 0);
+      this->circuitOutCt[lane][ix].assign(ckt.n_output_bits[ix], nullptr);
+    }
+  }
+  this->generation = 0;
+  this->Reset();
+}
+
+void EvaluationState::Reset(void) {
+  // a run that stopped early (an aborted request, a reset stream slot)
+  // leaves ciphertexts on wires that were never read. a complete run
+  // has released them all, so the walk is only needed after a partial one
+  if (this->liveCipherTexts != 0) {
+    for (size_t ix = 0; ix < this->readersLeft.size(); ix++) {
+      if (this->readersLeft[ix] != 0) {
+        this->readersLeft[ix] = 0;
+        this->wires[ix].setCipherText(nullptr);
+      }
+    }
+  }
+  // start a new generation, all gate and wire state becomes stale
+  this->generation++;
+  if (this->generation == 0) { // wrapped, really clear the tags
+    std::fill(this->gateGeneration.begin(), this->gateGeneration.end(), 0);
+    std::fill(this->wireGeneration.begin(), this->wireGeneration.end(), 0);
+    this->generation = 1;
+  }
+  this->activeWires.clear();
+  this->executingGates.clear();
+  this->n_done = 0;
+  this->liveCipherTexts = 0;
+  this->peakLiveCipherTexts = 0;
+  // outputs are not tagged, an output the next run leaves undriven must
+  // read 0, not the value of this run
+  for (auto &lane : this->circuitOutCt) {
+    for (auto &bus : lane) {
+      std::fill(bus.begin(), bus.end(), nullptr);
+    }
+  }
+  for (auto &lane : this->circuitOut) {
+    for (auto &bus : lane) {
+      std::fill(bus.begin(), bus.end(), 0);
+    }
+  }
+
+  // clear counters
+  this->n_input_gates = 0;
+  this->n_output_gates = 0;
+  this->n_and_gates = 0;
+  this->n_or_gates = 0;
+  this->n_xor_gates = 0;
+  this->n_not_gates = 0;
+  this->n_multi_gates = 0;
+  this->n_lut_gates = 0;
+}
+
+bool EvaluationState::driveWire(WireId w) {
+  if (this->wireGeneration[w] == this->generation) {
+    return false;
+  }
+  this->wireGeneration[w] = this->generation;
+  return true;
+}
+
+unsigned int EvaluationState::arriveInput(const CompiledCircuit &ckt,
+                                          GateId g) {
+  if (this->gateGeneration[g] != this->generation) {
+    // first input of this generation, every gate waits for all inputs
+    this->gateGeneration[g] = this->generation;
+    this->pendingInputs[g] = ckt.allGates[g].inWires.size();
+  }
+  return --this->pendingInputs[g];
+}
+
+void EvaluationState::holdCipherText(const CompiledCircuit &ckt, WireId w,
+                                     unsigned int lane, CipherText ct) {
+  // the count is set when the wire is driven, so Reset() need not clear it
+  size_t ix = size_t(w) * this->lanes + lane;
+  this->readersLeft[ix] = ckt.nl[w].size();
+  if (this->readersLeft[ix] == 0) {
+    this->wires[ix].setCipherText(nullptr);
+    return;
+  }
+  this->wires[ix].setCipherText(ct);
+  size_t live, peak;
+#pragma omp atomic capture seq_cst
+  live = ++this->liveCipherTexts;
+#pragma omp atomic read
+  peak = this->peakLiveCipherTexts;
+  if (live > peak) {
+#pragma omp critical(peak_live)
+    this->peakLiveCipherTexts = std::max(this->peakLiveCipherTexts, live);
+  }
+}
+
+uint32_t EvaluationState::readsLeft(WireId w, unsigned int lane) const {
+  uint32_t left;
+#pragma omp atomic read
+  left = this->readersLeft[size_t(w) * this->lanes + lane];
+  return left;
+}
+
+CipherText EvaluationState::readCipherText(WireId w, unsigned int lane) {
+  size_t ix = size_t(w) * this->lanes + lane;
+  CipherText ct = this->wires[ix].getCipherText();
+  uint32_t left;
+#pragma omp atomic capture seq_cst
+  left = --this->readersLeft[ix];
+  if (left == 0) {
+    this->wires[ix].setCipherText(nullptr); // last reader, free it
+#pragma omp atomic
+    this->liveCipherTexts--;
+  }
+  return ct;
+}
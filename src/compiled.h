@@ -0,0 +1,170 @@
+// @file compiled.h -- compiled circuit and per evaluation state objects
+//==================================================================================
+// BSD 2-Clause License
+//
+// Copyright (c) 2014-2022, NJIT, Duality Technologies Inc. and other
+// contributors
+//
+// All rights reserved.
+//
+// Author TPOC: contact@openfhe.org
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//==================================================================================
+
+#ifndef COMPILED_H
+#define COMPILED_H
+
+#include "gate.h"
+#include "schedule.h"
+#include "wire.h"
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+using GateList = std::vector<Gate>;
+using GateQueue = std::deque<GateId>;
+
+using Inputs = std::vector<std::vector<unsigned int>>;
+using Outputs = std::vector<std::vector<unsigned int>>;
+// fanout gates of every wire, indexed by WireId. a gate appears once for
+// every input that reads the wire.
+using NetList = std::vector<GateIdList>;
+
+// the immutable description of a loaded circuit. it is built once by a
+// loader and then only read, so one CompiledCircuit can be shared by any
+// number of evaluations, each with its own EvaluationState.
+class CompiledCircuit {
+public:
+  CompiledCircuit();
+  ~CompiledCircuit();
+
+  // builder interface used by the loaders
+  WireId addWire(const std::string &name); // name only kept if keepNames
+  GateId addGate(Gate g); // assigns the gate id and indexes the netlist
+  void setOutputBits(std::vector<unsigned int> bits);
+  void finalize(void); // call once after the last gate is added
+
+  // binary image of the finalized circuit, wire names are not kept.
+  // Map() reads one back from a memory mapped file without parsing.
+  void Save(const std::string &fname) const;
+  static std::shared_ptr<CompiledCircuit> Map(const std::string &fname);
+
+  std::string wireName(WireId w) const;
+  size_t numberWires(void) const;
+
+  bool keepNames; // keep the wire name side table
+
+  GateList inputGates; // input gates in ckt
+  GateList allGates;   // all other gates in ckt, indexed by GateId
+  GateIdList outputGates; // ids of the OUTPUT gates in allGates
+  NetList nl; // full net list of the ckt (all wires and fanout gates)
+  std::vector<std::string> wireNames; // optional, wire names for debug
+  // bootstraps on the longest path from each gate to an output,
+  // including the gate itself. used as the ready queue priority
+  std::vector<unsigned int> gateHeight;
+  unsigned int criticalPath; // max of gateHeight
+  // ready queue priority of the memory bounded schedule: gates that free
+  // more ciphertexts than they create first, then by gateHeight
+  std::vector<unsigned int> memoryPriority;
+  bool techMapped;       // already rewritten by TechMap()
+  bool inversionsPushed; // already rewritten by PushInversions()
+  bool optimized;        // already rewritten by Optimize()
+  bool rebalanced;       // already rewritten by Rebalance()
+  bool lutMapped;        // already rewritten by LutMap()
+  // copy the already rewritten flags above, for a pass writing a new
+  // circuit from another one
+  void copyPassFlags(const CompiledCircuit &from);
+  // plaintext modulus of every ciphertext in the circuit, 4 unless it has
+  // LUT gates (see GatePlaintextModulus())
+  unsigned int plaintextModulus;
+
+  unsigned int n_outputs;
+  std::vector<unsigned int> n_output_bits;
+  std::vector<unsigned int> n_input_bits; // width of every input bus
+};
+
+// the mutable state of one evaluation of a CompiledCircuit. Init() sizes
+// it for a circuit once, after that Reset() only clears the outputs and
+// the wire ciphertexts a partial run left unread: per gate and per wire
+// state is tagged with the generation it was written in and anything
+// from an older generation is treated as cleared.
+// an evaluation can carry several independent requests (lanes) through
+// one schedule, each lane has its own wire values and outputs.
+class EvaluationState {
+public:
+  EvaluationState();
+  ~EvaluationState();
+  void Init(const CompiledCircuit &ckt, unsigned int lanes = 1);
+  void Reset(void);
+
+  // value of wire w for request lane
+  Wire &wire(WireId w, unsigned int lane) {
+    return this->wires[size_t(w) * this->lanes + lane];
+  }
+
+  // mark a wire driven, returns false if it was already driven
+  bool driveWire(WireId w);
+  // one input of gate g arrived, returns the number still pending
+  unsigned int arriveInput(const CompiledCircuit &ckt, GateId g);
+
+  // a wire holds its ciphertext only until the last gate reading it has
+  // read it. holdCipherText() stores a driven ciphertext (or drops it if
+  // nothing reads the wire), readCipherText() returns it and releases it
+  // on the last read. safe to call from several threads.
+  void holdCipherText(const CompiledCircuit &ckt, WireId w, unsigned int lane,
+                      CipherText ct);
+  CipherText readCipherText(WireId w, unsigned int lane);
+  // reads of wire w still to come
+  uint32_t readsLeft(WireId w, unsigned int lane) const;
+
+  unsigned int lanes; // number of requests evaluated together
+  WireList wires;     // current value of every wire, lanes per wire
+  WireQueue activeWires;
+  ReadyQueue executingGates;
+  size_t n_done; // gates evaluated in this generation
+  std::vector<Outputs> circuitOut; // per lane
+  std::vector<std::vector<CipherTextList>> circuitOutCt; // before decryption
+  size_t liveCipherTexts;     // ciphertexts held by wires right now
+  size_t peakLiveCipherTexts; // most held at once in this generation
+
+  unsigned int n_input_gates;
+  unsigned int n_output_gates;
+  unsigned int n_and_gates;
+  unsigned int n_or_gates;
+  unsigned int n_xor_gates;
+  unsigned int n_not_gates;
+  unsigned int n_multi_gates; // AND3, OR3 and MAJORITY
+  unsigned int n_lut_gates;   // LUT3 and LUT4
+
+private:
+  uint32_t generation;
+  std::vector<uint32_t> gateGeneration;
+  std::vector<uint32_t> wireGeneration;
+  std::vector<unsigned int> pendingInputs; // # inputs each gate waits on
+  std::vector<uint32_t> readersLeft; // # reads left of each wire, per lane
+};
+
+#endif
@@ -36,47 +36,142 @@
 
 #include <iostream>
 
-GateEvalParams::GateEvalParams(void) {}
+unsigned int GateBootstraps(GateEnum op) {
+  switch (op) {
+  case (GateEnum::AND):
+  case (GateEnum::OR):
+  case (GateEnum::XOR):
+  case (GateEnum::AND3):
+  case (GateEnum::OR3):
+  case (GateEnum::MAJORITY):
+  case (GateEnum::NAND):
+  case (GateEnum::NOR):
+  case (GateEnum::XNOR):
+  case (GateEnum::LUT3):
+  case (GateEnum::LUT4):
+    return 1;
+  default: // I/O and NOT are free
+    return 0;
+  }
+}
+
+unsigned int GatePlaintextModulus(GateEnum op) {
+  switch (op) {
+  case (GateEnum::LUT3):
+    return 16;
+  case (GateEnum::LUT4):
+    return 32;
+  default:
+    return 4;
+  }
+}
+
+LutTable GenerateLutTable(const KeySet &keys, uint16_t truthTable,
+                          unsigned int p) {
+  // entry i holds the output for message i / (q / p), scaled by q / p.
+  // only the lower half of the messages are rows, the upper half is the
+  // negation of the lower half
+  uint64_t q = keys.cc.GetParams()->GetLWEParams()->Getq().ConvertToInt();
+  uint64_t scale = q / p;
+  LutTable table(q);
+  for (uint64_t i = 0; i < q; i++) {
+    uint64_t row = (i / scale) % (p / 2);
+    uint64_t out = (row < 16) ? ((truthTable >> row) & 1) : 0;
+    uint64_t value = (out + 1) * scale;
+    table[i] = (i / scale < p / 2) ? value : q - value;
+  }
+  return table;
+}
+
+GateEvalParams::GateEvalParams(void) : plaintextModulus(4) {}
 
 GateEvalParams::~GateEvalParams(void) {}
 
-Gate::Gate(void) {}
+Gate::Gate(void)
+    : id(0), op(GateEnum::INPUT), ioBus(0), ioBit(0), truthTable(0) {}
 
 Gate::~Gate(void) {}
 
-void Gate::Reset(void) {}
+std::string Gate::getName(void) const {
+  std::string opName;
+  switch (this->op) {
+  case (GateEnum::INPUT):
+    opName = "INPUT";
+    break;
+  case (GateEnum::OUTPUT):
+    opName = "OUTPUT";
+    break;
+  case (GateEnum::NOT):
+    opName = "NOT";
+    break;
+  case (GateEnum::AND):
+    opName = "AND";
+    break;
+  case (GateEnum::OR):
+    opName = "OR";
+    break;
+  case (GateEnum::XOR):
+    opName = "XOR";
+    break;
+  case (GateEnum::DFF):
+    opName = "DFF";
+    break;
+  case (GateEnum::LUT3):
+    opName = "LUT3";
+    break;
+  case (GateEnum::LUT4):
+    opName = "LUT4";
+    break;
+  case (GateEnum::AND3):
+    opName = "AND3";
+    break;
+  case (GateEnum::OR3):
+    opName = "OR3";
+    break;
+  case (GateEnum::MAJORITY):
+    opName = "MAJORITY";
+    break;
+  case (GateEnum::NAND):
+    opName = "NAND";
+    break;
+  case (GateEnum::NOR):
+    opName = "NOR";
+    break;
+  case (GateEnum::XNOR):
+    opName = "XNOR";
+    break;
+  }
+  return opName + ":" + std::to_string(this->id);
+}
 
-void Gate::Evaluate(const GateEvalParams &gep) {
+void Gate::Evaluate(const GateEvalParams &gep, GateValues &v) const {
   OPENFHE_DEBUG_FLAG(false);
-  OPENFHE_DEBUG("in evaluate for gate " << this->name);
-
-  bool all_ready(true);
+  OPENFHE_DEBUG("in evaluate for gate " << this->getName());
 
   auto plaintext_flag = gep.plaintext_flag;
   auto encrypted_flag = gep.encrypted_flag;
   auto verify_flag = gep.verify_flag;
 
-  for (auto it : this->ready) {
-    all_ready &= it;
-  }
-  if (!all_ready) {
-    std::cerr << "error, executing gate " << this->name
+  if ((encrypted_flag && (v.encin.size() != this->inWires.size())) ||
+      (plaintext_flag && (v.plainin.size() != this->inWires.size()))) {
+    std::cerr << "error, executing gate " << this->getName()
               << " but inputs not ready!" << std::endl;
   }
-  OPENFHE_DEBUGEXP(this->encin.size());
+  OPENFHE_DEBUGEXP(v.encin.size());
   OPENFHE_DEBUGEXP(plaintext_flag);
   OPENFHE_DEBUGEXP(encrypted_flag);
   if (encrypted_flag & dbg_flag) {
-    OPENFHE_DEBUGEXP(this->encin[0]);
+    OPENFHE_DEBUGEXP(v.encin[0]);
     lbcrypto::LWEPlaintext res;
-    gep.cc.Decrypt(gep.sk, this->encin[0], &res);
+    auto p = gep.plaintextModulus;
+    gep.keys->cc.Decrypt(gep.keys->sk, v.encin[0], &res, p);
     OPENFHE_DEBUGEXP(res);
-    if (this->encin.size() > 1) {
-      gep.cc.Decrypt(gep.sk, this->encin[1], &res);
+    if (v.encin.size() > 1) {
+      gep.keys->cc.Decrypt(gep.keys->sk, v.encin[1], &res, p);
       OPENFHE_DEBUGEXP(res);
     }
   }
-  OPENFHE_DEBUGEXP(this->name);
+  OPENFHE_DEBUGEXP(this->getName());
 
   switch (this->op) {
   case (GateEnum::INPUT):
@@ -84,19 +179,22 @@ void Gate::Evaluate(const GateEvalParams &gep) {
     break;
   case (GateEnum::OUTPUT):
     if (plaintext_flag) {
-      plainout.resize(1);
-      plainout[0] = this->plainin[0]; // copy input
+      v.plainout.resize(1);
+      v.plainout[0] = v.plainin[0]; // copy input
     }
     if (encrypted_flag) {
       // lbcrypto::LWEPlaintext res;
 
-      encout.resize(1);
-      encout[0] = encin[0];
+      v.encout.resize(1);
+      v.encout[0] = v.encin[0];
       if (verify_flag) {
+        // at the circuit modulus, larger in LUT circuits. a bootstrapped
+        // ciphertext does not carry it
         lbcrypto::LWEPlaintext res;
-        gep.cc.Decrypt(gep.sk, this->encin[0], &res);
+        gep.keys->cc.Decrypt(gep.keys->sk, v.encin[0], &res,
+                             gep.plaintextModulus);
         unsigned int out = (unsigned int)res;
-        if (out != plainout[0]) {
+        if (out != v.plainout[0]) {
           std::cerr << "Bad OUTPUT fixing" << std::endl;
         }
       }
@@ -104,79 +202,79 @@ void Gate::Evaluate(const GateEvalParams &gep) {
     break;
   case (GateEnum::NOT):
     if (plaintext_flag) {
-      plainout.resize(1);
-      plainout[0] = !this->plainin[0];
+      v.plainout.resize(1);
+      v.plainout[0] = !v.plainin[0];
     }
     if (encrypted_flag) {
-      encout.resize(1);
-      encout[0] = gep.cc.EvalNOT(this->encin[0]);
+      v.encout.resize(1);
+      v.encout[0] = gep.keys->cc.EvalNOT(v.encin[0]);
       if (verify_flag) {
         lbcrypto::LWEPlaintext res;
-        gep.cc.Decrypt(gep.sk, encout[0], &res);
-        if (res != plainout[0]) {
+        gep.keys->cc.Decrypt(gep.keys->sk, v.encout[0], &res);
+        if (res != v.plainout[0]) {
           std::cerr << "Bad NOT fixing" << std::endl;
-          encout[0] = gep.cc.Encrypt(gep.sk, plainout[0]);
+          v.encout[0] = gep.keys->cc.Encrypt(gep.keys->sk, v.plainout[0]);
         }
       }
     }
     break;
   case (GateEnum::AND):
     if (plaintext_flag) {
-      plainout.resize(1);
-      plainout[0] = this->plainin[0] && this->plainin[1];
+      v.plainout.resize(1);
+      v.plainout[0] = v.plainin[0] && v.plainin[1];
     }
 
     if (encrypted_flag) {
-      encout.resize(1);
+      v.encout.resize(1);
       try {
-        encout[0] =
-            gep.cc.EvalBinGate(lbcrypto::AND, this->encin[0], this->encin[1]);
+        v.encout[0] =
+            gep.keys->cc.EvalBinGate(lbcrypto::AND, v.encin[0], v.encin[1]);
       } catch (...) {
-        std::cerr << "throw!! executing gate RETRY " << this->name << std::endl;
+        std::cerr << "throw!! executing gate RETRY " << this->getName() << std::endl;
         lbcrypto::LWEPlaintext res;
-        gep.cc.Decrypt(gep.sk, this->encin[0], &res);
+        gep.keys->cc.Decrypt(gep.keys->sk, v.encin[0], &res);
         std::cerr << "in[0] " << res << std::endl;
-        this->encin[0] = gep.cc.Encrypt(gep.sk, res);
+        v.encin[0] = gep.keys->cc.Encrypt(gep.keys->sk, res);
 
-        gep.cc.Decrypt(gep.sk, this->encin[1], &res);
+        gep.keys->cc.Decrypt(gep.keys->sk, v.encin[1], &res);
         std::cerr << "in[1] " << res << std::endl;
-        this->encin[1] = gep.cc.Encrypt(gep.sk, res);
+        v.encin[1] = gep.keys->cc.Encrypt(gep.keys->sk, res);
         try {
-          encout[0] =
-              gep.cc.EvalBinGate(lbcrypto::AND, this->encin[0], this->encin[1]);
+          v.encout[0] =
+              gep.keys->cc.EvalBinGate(lbcrypto::AND, v.encin[0], v.encin[1]);
         } catch (...) {
-          std::cerr << "FAILED rethrow!! executing gate RETRY " << this->name
+          std::cerr << "FAILED rethrow!! executing gate RETRY " << this->getName()
                     << std::endl;
           exit(-1);
         }
       }
       if (verify_flag) {
         lbcrypto::LWEPlaintext res;
-        gep.cc.Decrypt(gep.sk, encout[0], &res);
-        if (res != plainout[0]) {
+        gep.keys->cc.Decrypt(gep.keys->sk, v.encout[0], &res);
+        if (res != v.plainout[0]) {
           std::cerr << "Bad AND fixing" << std::endl;
-          encout[0] = gep.cc.Encrypt(gep.sk, plainout[0]);
+          v.encout[0] = gep.keys->cc.Encrypt(gep.keys->sk, v.plainout[0]);
         }
       }
     }
     break;
   case (GateEnum::OR):
     if (plaintext_flag) {
-      plainout.resize(1);
-      plainout[0] = this->plainin[0] || this->plainin[1];
+      v.plainout.resize(1);
+      v.plainout[0] = v.plainin[0] || v.plainin[1];
     }
 
     if (encrypted_flag) {
-      encout.resize(1);
-      encout[0] =
-          gep.cc.EvalBinGate(lbcrypto::OR, this->encin[0], this->encin[1]);
+      v.encout.resize(1);
+      v.encout[0] =
+          gep.keys->cc.EvalBinGate(lbcrypto::OR, v.encin[0], v.encin[1]);
 
       if (verify_flag) {
         lbcrypto::LWEPlaintext res;
-        gep.cc.Decrypt(gep.sk, encout[0], &res);
-        if (res != plainout[0]) {
+        gep.keys->cc.Decrypt(gep.keys->sk, v.encout[0], &res);
+        if (res != v.plainout[0]) {
           std::cerr << "Bad OR fixing" << std::endl;
-          encout[0] = gep.cc.Encrypt(gep.sk, plainout[0]);
+          v.encout[0] = gep.keys->cc.Encrypt(gep.keys->sk, v.plainout[0]);
         }
       }
     }
@@ -184,39 +282,151 @@ void Gate::Evaluate(const GateEvalParams &gep) {
     break;
   case (GateEnum::XOR):
     if (plaintext_flag) {
-      plainout.resize(1);
-      plainout[0] = this->plainin[0] ^ this->plainin[1];
-      OPENFHE_DEBUGEXP(plainout[0]);
+      v.plainout.resize(1);
+      v.plainout[0] = v.plainin[0] ^ v.plainin[1];
+      OPENFHE_DEBUGEXP(v.plainout[0]);
     }
 
     if (encrypted_flag) {
-      encout.resize(1);
+      v.encout.resize(1);
 #if 1 // current XOR has a higher failure rate, replace with equivalent gates
-	  auto foo = gep.cc.EvalBinGate(lbcrypto::XOR, this->encin[0], this->encin[1]);
+	  auto foo = gep.keys->cc.EvalBinGate(lbcrypto::XOR, v.encin[0], v.encin[1]);
 #else
-	  auto foo = gep.cc.EvalBinGate(lbcrypto::XOR_FAST, this->encin[0], this->encin[1]);    
+	  auto foo = gep.keys->cc.EvalBinGate(lbcrypto::XOR_FAST, v.encin[0], v.encin[1]);    
 #endif
-      encout[0] = foo;
-      OPENFHE_DEBUGEXP(encout[0]);
+      v.encout[0] = foo;
+      OPENFHE_DEBUGEXP(v.encout[0]);
       if (verify_flag) {
         lbcrypto::LWEPlaintext res;
-        gep.cc.Decrypt(gep.sk, encout[0], &res);
-        if (res != plainout[0]) {
+        gep.keys->cc.Decrypt(gep.keys->sk, v.encout[0], &res);
+        if (res != v.plainout[0]) {
           std::cerr << "Bad XOR fixing" << std::endl;
-          encout[0] = gep.cc.Encrypt(gep.sk, plainout[0]);
+          v.encout[0] = gep.keys->cc.Encrypt(gep.keys->sk, v.plainout[0]);
         }
       }
     }
 
+    break;
+  case (GateEnum::NAND):
+  case (GateEnum::NOR):
+  case (GateEnum::XNOR):
+    // inverted AND, OR and XOR, same cost as the plain gates
+    if (plaintext_flag) {
+      v.plainout.resize(1);
+      if (this->op == GateEnum::NAND) {
+        v.plainout[0] = !(v.plainin[0] && v.plainin[1]);
+      } else if (this->op == GateEnum::NOR) {
+        v.plainout[0] = !(v.plainin[0] || v.plainin[1]);
+      } else {
+        v.plainout[0] = !(v.plainin[0] ^ v.plainin[1]);
+      }
+    }
+
+    if (encrypted_flag) {
+      auto gate = lbcrypto::XNOR;
+      if (this->op == GateEnum::NAND) {
+        gate = lbcrypto::NAND;
+      } else if (this->op == GateEnum::NOR) {
+        gate = lbcrypto::NOR;
+      }
+      v.encout.resize(1);
+      v.encout[0] = gep.keys->cc.EvalBinGate(gate, v.encin[0], v.encin[1]);
+      if (verify_flag) {
+        lbcrypto::LWEPlaintext res;
+        gep.keys->cc.Decrypt(gep.keys->sk, v.encout[0], &res);
+        if (res != v.plainout[0]) {
+          std::cerr << "Bad " << this->getName() << " fixing" << std::endl;
+          v.encout[0] = gep.keys->cc.Encrypt(gep.keys->sk, v.plainout[0]);
+        }
+      }
+    }
+    break;
+  case (GateEnum::AND3):
+  case (GateEnum::OR3):
+  case (GateEnum::MAJORITY):
+    // one bootstrap on the sum of the three inputs
+    if (plaintext_flag) {
+      unsigned int ones = v.plainin[0] + v.plainin[1] + v.plainin[2];
+      v.plainout.resize(1);
+      if (this->op == GateEnum::AND3) {
+        v.plainout[0] = (ones == 3);
+      } else if (this->op == GateEnum::OR3) {
+        v.plainout[0] = (ones > 0);
+      } else {
+        v.plainout[0] = (ones > 1);
+      }
+    }
+
+    if (encrypted_flag) {
+      auto gate = lbcrypto::MAJORITY;
+      if (this->op == GateEnum::AND3) {
+        gate = lbcrypto::AND3;
+      } else if (this->op == GateEnum::OR3) {
+        gate = lbcrypto::OR3;
+      }
+      v.encout.resize(1);
+      v.encout[0] = gep.keys->cc.EvalBinGate(gate, v.encin);
+      if (verify_flag) {
+        lbcrypto::LWEPlaintext res;
+        gep.keys->cc.Decrypt(gep.keys->sk, v.encout[0], &res);
+        if (res != v.plainout[0]) {
+          std::cerr << "Bad " << this->getName() << " fixing" << std::endl;
+          v.encout[0] = gep.keys->cc.Encrypt(gep.keys->sk, v.plainout[0]);
+        }
+      }
+    }
     break;
   case (GateEnum::DFF):
     std::cerr << "remember to write DFF" << std::endl;
     break;
   case (GateEnum::LUT3):
-    std::cerr << "remember to write LUT3" << std::endl;
-    break;
   case (GateEnum::LUT4):
-    std::cerr << "remember to write LUT4" << std::endl;
+    // one functional bootstrap. the inputs are summed with weights 1, 2,
+    // 4, 8 into one ciphertext whose message is the row number, and
+    // EvalFunc looks the row up in the table the circuit built for the
+    // truth table. the plaintext modulus is at least twice the number of
+    // rows, so the sum stays in the lower half and the table is extended
+    // negacyclically, which needs no second bootstrap.
+    if (plaintext_flag) {
+      unsigned int row = 0;
+      for (size_t i = 0; i < v.plainin.size(); i++) {
+        row |= (v.plainin[i] & 1) << i;
+      }
+      v.plainout.resize(1);
+      v.plainout[0] = (this->truthTable >> row) & 1;
+    }
+
+    if (encrypted_flag) {
+      // the circuit modulus, a bootstrapped ciphertext does not carry it
+      auto p = gep.plaintextModulus;
+      const auto &lwe = gep.keys->cc.GetLWEScheme();
+      auto sum = std::make_shared<lbcrypto::LWECiphertextImpl>(*v.encin[0]);
+      for (size_t i = 1; i < v.encin.size(); i++) {
+        auto term = std::make_shared<lbcrypto::LWECiphertextImpl>(*v.encin[i]);
+        lwe->EvalMultConstEq(term, 1 << i);
+        lwe->EvalAddEq(sum, term);
+      }
+      auto lut = gep.lutTables.find(this->truthTable);
+      if (lut == gep.lutTables.end()) {
+        // the circuit builds a table for every truth table it loads
+        std::cerr << "error, no LUT table for " << this->getName()
+                  << std::endl;
+        exit(-1);
+      }
+      v.encout.resize(1);
+      v.encout[0] = gep.keys->cc.EvalFunc(sum, lut->second);
+      // remove the offset of the table, see GenerateLutTable()
+      lwe->EvalSubConstEq(v.encout[0], v.encout[0]->GetModulus() / p);
+      if (verify_flag) {
+        lbcrypto::LWEPlaintext res;
+        gep.keys->cc.Decrypt(gep.keys->sk, v.encout[0], &res, p);
+        if (res != v.plainout[0]) {
+          std::cerr << "Bad " << this->getName() << " fixing" << std::endl;
+          v.encout[0] = gep.keys->cc.Encrypt(gep.keys->sk, v.plainout[0],
+                                             lbcrypto::FRESH, p);
+        }
+      }
+    }
     break;
   default:
     std::cerr << "bad gate eval" << std::endl;
@@ -36,19 +36,61 @@
 #ifndef GATE_H
 #define GATE_H
 
+#include "keys.h"
 #include "wire.h"
 #include <algorithm>
+#include <cstdint>
 #include <deque>
 #include <map>
 #include <string>
 #include <vector>
 
-// using ReadyList = std::map<std::string, bool>;
-using ReadyList = std::vector<bool>;
 using CipherTextList = std::vector<CipherText>;
 using BitList = std::vector<unsigned int>;
 
-enum class GateEnum { INPUT, OUTPUT, NOT, AND, OR, XOR, DFF, LUT3, LUT4 };
+// AND3, OR3 and MAJORITY are the three input gates of binfhe, written by
+// TechMap(). they need a parameter set that supports them (e.g.
+// STD128Q_3_LMKCDEY). NAND, NOR and XNOR are written by PushInversions().
+// LUT3 and LUT4 are any function of up to three or four inputs, written by
+// LutMap() and evaluated with one functional bootstrap (EvalFunc).
+// compiled circuit files store the value, so new kinds go at the end
+// and CompiledCircuit::Map() checks against the last one.
+enum class GateEnum {
+  INPUT,
+  OUTPUT,
+  NOT,
+  AND,
+  OR,
+  XOR,
+  DFF,
+  LUT3,
+  LUT4,
+  AND3,
+  OR3,
+  MAJORITY,
+  NAND,
+  NOR,
+  XNOR
+};
+
+// number of bootstraps needed to evaluate one gate of this kind
+unsigned int GateBootstraps(GateEnum op);
+
+// least plaintext modulus of the ciphertexts a gate of this kind reads
+// and writes: 4 for the boolean gates, twice the number of truth table
+// rows for LUT gates. a circuit uses the largest over its gates.
+unsigned int GatePlaintextModulus(GateEnum op);
+
+// EvalFunc table of a LUT gate, one entry per value of the ciphertext
+// modulus q
+using LutTable = std::vector<lbcrypto::NativeInteger>;
+
+// the EvalFunc table of a LUT3/LUT4 gate with this truth table under
+// plaintext modulus p. the output is offset by one, so the table is
+// negacyclic (EvalFunc needs one bootstrap) with no zero entry; the
+// gate subtracts the offset again.
+LutTable GenerateLutTable(const KeySet &keys, uint16_t truthTable,
+                          unsigned int p);
 
 class GateEvalParams {
 public:
@@ -57,26 +99,40 @@ public:
   bool plaintext_flag;
   bool encrypted_flag;
   bool verify_flag;
+  unsigned int plaintextModulus; // of every ciphertext in the circuit
+  // tables of the LUT gates of the circuit, by truth table. built once
+  // when the circuit is loaded, read only while it is evaluated
+  std::map<uint16_t, LutTable> lutTables;
 
-  lbcrypto::BinFHEContext cc;
-  lbcrypto::LWEPrivateKey sk;
+  KeySetPtr keys; // shared by all gates and circuits under one key set
 };
 
-class Gate {
+// the input and output values of one gate evaluation. kept apart from
+// the Gate so a gate definition can be shared by concurrent evaluations.
+class GateValues {
 public:
-  Gate();
-  ~Gate();
-  void Reset(void);
-  void Evaluate(const GateEvalParams &);
-  std::string name; // note can be an integer
-  GateEnum op;
-  NameList inWireNames;
-  ReadyList ready;
-  NameList outWireNames;
   CipherTextList encin;
   BitList plainin;
   CipherTextList encout;
   BitList plainout;
 };
 
+// a gate definition, it holds no per evaluation state
+class Gate {
+public:
+  Gate();
+  ~Gate();
+  void Evaluate(const GateEvalParams &, GateValues &) const;
+  std::string getName(void) const; // for debug output only
+  GateId id; // index of the gate in its gate list
+  GateEnum op;
+  WireIdList inWires;
+  WireIdList outWires;
+  unsigned int ioBus; // INPUT/OUTPUT gates: bus number
+  unsigned int ioBit; // INPUT/OUTPUT gates: bit number within the bus
+  // LUT3/LUT4 gates: bit r is the output for input row r, where input i
+  // is bit i of r
+  uint16_t truthTable;
+};
+
 #endif
@@ -0,0 +1,229 @@
+// @file keys.cpp -- crypto context and key set generation and key store
+//==================================================================================
+// BSD 2-Clause License
+//
+// Copyright (c) 2014-2022, NJIT, Duality Technologies Inc. and other
+// contributors
+//
+// All rights reserved.
+//
+// Author TPOC: contact@openfhe.org
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//==================================================================================
+#include "keys.h"
+
+#include <filesystem>
+#include <iostream>
+
+#include "binfhecontext-ser.h"
+
+// file names within a key set directory
+static const std::string ccFile("/cryptoContext.bin");
+static const std::string skFile("/secretKey.bin");
+static const std::string refreshFile("/refreshKey.bin");
+static const std::string switchFile("/switchingKey.bin");
+
+// directory name of a key set within the key store
+static std::string keySetName(lbcrypto::BINFHE_PARAMSET set,
+                              lbcrypto::BINFHE_METHOD method) {
+  std::string name;
+  switch (set) {
+  case (lbcrypto::TOY):
+    name = "TOY";
+    break;
+  case (lbcrypto::STD128):
+    name = "STD128";
+    break;
+  case (lbcrypto::STD128Q_LMKCDEY):
+    name = "STD128Q_LMKCDEY";
+    break;
+  case (lbcrypto::STD128Q_3_LMKCDEY):
+    name = "STD128Q_3_LMKCDEY";
+    break;
+  default:
+    name = "SET" + std::to_string(int(set));
+  }
+  switch (method) {
+  case (lbcrypto::AP):
+    return name + "_AP";
+  case (lbcrypto::GINX):
+    return name + "_GINX";
+  case (lbcrypto::LMKCDEY):
+    return name + "_LMKCDEY";
+  default:
+    return name + "_METHOD" + std::to_string(int(method));
+  }
+}
+
+// OpenFHE only builds a context for functional bootstrapping with GINX
+// and the STD128 or TOY parameter sets. any other choice is replaced,
+// with a message, so -u works with the default set and method
+static void lutParameters(lbcrypto::BINFHE_PARAMSET *set,
+                          lbcrypto::BINFHE_METHOD *method,
+                          unsigned int lutInputs) {
+  if (lutInputs == 0) {
+    return;
+  }
+  if ((*set != lbcrypto::STD128) && (*set != lbcrypto::TOY)) {
+    std::cout << "LUT gates need the STD128 or TOY parameter set, using "
+                 "STD128"
+              << std::endl;
+    *set = lbcrypto::STD128;
+  }
+  if (*method != lbcrypto::GINX) {
+    std::cout << "LUT gates need the GINX method, using GINX" << std::endl;
+    *method = lbcrypto::GINX;
+  }
+}
+
+KeySet GenerateKeySet(lbcrypto::BINFHE_PARAMSET set,
+                      lbcrypto::BINFHE_METHOD method,
+                      unsigned int lutInputs) {
+  KeySet keys;
+  lutParameters(&set, &method, lutInputs);
+  std::cout << "Generating crypto context" << std::endl;
+  if (set == lbcrypto::TOY) {
+    std::cout << "*************************" << std::endl;
+    std::cout << "WARNING TOY Security used" << std::endl;
+    std::cout << "*************************" << std::endl;
+  } else if (set == lbcrypto::STD128) {
+    std::cout << "STD128 Security used" << std::endl;
+  } else if (set == lbcrypto::STD128Q_LMKCDEY) {
+    std::cout << "STD128Q_LMKCDEY Security used" << std::endl;
+  } else if (set == lbcrypto::STD128Q_3_LMKCDEY) {
+    std::cout << "STD128Q_3_LMKCDEY Security used" << std::endl;
+  } else {
+    std::cerr << "Error Bad security" << std::endl;
+    exit(-1);
+  }
+  if (method == lbcrypto::AP) {
+    std::cout << "AP used" << std::endl;
+  } else if (method == lbcrypto::GINX) {
+    std::cout << "GINX used" << std::endl;
+  } else if (method == lbcrypto::LMKCDEY) {
+    std::cout << "LMKCDEY used" << std::endl;
+  } else {
+    std::cerr << "Error Bad method" << std::endl;
+    exit(-1);
+  }
+
+  TIC(auto t_keys);
+  if (lutInputs == 0) {
+    keys.cc.GenerateBinFHEContext(set, method);
+  } else {
+    // one more bit of ciphertext modulus for each doubling of the
+    // plaintext space, LUTs of k inputs need 2^(k+1)
+    uint32_t logQ = 9 + lutInputs;
+    uint64_t p = 2 << lutInputs;
+    keys.cc.GenerateBinFHEContext(set, true, logQ, 0, method);
+    uint64_t max_p = keys.cc.GetMaxPlaintextSpace().ConvertToInt();
+    if (max_p < p) {
+      std::cerr << "Error LUT" << lutInputs << " gates need plaintext space "
+                << p << ", the context has " << max_p << std::endl;
+      exit(-1);
+    }
+    std::cout << "functional bootstrapping for LUT" << lutInputs
+              << ", plaintext space " << max_p << std::endl;
+  }
+  std::cout << "Generating crypto keys" << std::endl;
+  keys.sk = keys.cc.KeyGen();
+  keys.cc.BTKeyGen(keys.sk);
+  std::cout << "Done" << std::endl;
+  std::cout << "### Key generation time " << TOC_MS(t_keys) << " msec"
+            << std::endl;
+  return keys;
+}
+
+bool SaveKeySet(const std::string &dir, const KeySet &keys) {
+  std::error_code ec;
+  std::filesystem::create_directories(dir, ec);
+  if (ec) {
+    std::cerr << "error creating key directory " << dir << ": "
+              << ec.message() << std::endl;
+    return false;
+  }
+  if (!lbcrypto::Serial::SerializeToFile(dir + ccFile, keys.cc,
+                                         lbcrypto::SerType::BINARY) ||
+      !lbcrypto::Serial::SerializeToFile(dir + skFile, keys.sk,
+                                         lbcrypto::SerType::BINARY) ||
+      !lbcrypto::Serial::SerializeToFile(dir + refreshFile,
+                                         keys.cc.GetRefreshKey(),
+                                         lbcrypto::SerType::BINARY) ||
+      !lbcrypto::Serial::SerializeToFile(dir + switchFile,
+                                         keys.cc.GetSwitchKey(),
+                                         lbcrypto::SerType::BINARY)) {
+    std::cerr << "error writing keys to " << dir << std::endl;
+    return false;
+  }
+  std::cout << "saved keys to " << dir << std::endl;
+  return true;
+}
+
+bool LoadKeySet(const std::string &dir, KeySet *keys) {
+  TIC(auto t_keys);
+  lbcrypto::RingGSWACCKey refreshKey;
+  lbcrypto::LWESwitchingKey switchKey;
+  if (!lbcrypto::Serial::DeserializeFromFile(dir + ccFile, keys->cc,
+                                             lbcrypto::SerType::BINARY) ||
+      !lbcrypto::Serial::DeserializeFromFile(dir + skFile, keys->sk,
+                                             lbcrypto::SerType::BINARY) ||
+      !lbcrypto::Serial::DeserializeFromFile(dir + refreshFile, refreshKey,
+                                             lbcrypto::SerType::BINARY) ||
+      !lbcrypto::Serial::DeserializeFromFile(dir + switchFile, switchKey,
+                                             lbcrypto::SerType::BINARY)) {
+    std::cerr << "error reading keys from " << dir << std::endl;
+    return false;
+  }
+  keys->cc.BTKeyLoad({refreshKey, switchKey});
+  std::cout << "### Key load time " << TOC_MS(t_keys) << " msec from "
+            << dir << std::endl;
+  return true;
+}
+
+KeySetPtr GetKeySet(const std::string &storeDir,
+                    lbcrypto::BINFHE_PARAMSET set,
+                    lbcrypto::BINFHE_METHOD method,
+                    unsigned int lutInputs) {
+  if (storeDir.empty()) {
+    return std::make_shared<const KeySet>(
+        GenerateKeySet(set, method, lutInputs));
+  }
+  // one key set per parameter set, method and LUT size
+  lutParameters(&set, &method, lutInputs);
+  std::string dir = storeDir + "/" + keySetName(set, method);
+  if (lutInputs != 0) {
+    dir += "_LUT" + std::to_string(lutInputs);
+  }
+  KeySet keys;
+  if (std::filesystem::exists(dir + ccFile)) {
+    if (LoadKeySet(dir, &keys)) {
+      return std::make_shared<const KeySet>(std::move(keys));
+    }
+    std::cerr << "regenerating keys" << std::endl;
+  }
+  keys = GenerateKeySet(set, method, lutInputs);
+  SaveKeySet(dir, keys);
+  return std::make_shared<const KeySet>(std::move(keys));
+}
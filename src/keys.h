@@ -0,0 +1,87 @@
+// @file keys.h -- crypto context and key set generation and key store
+//==================================================================================
+// BSD 2-Clause License
+//
+// Copyright (c) 2014-2022, NJIT, Duality Technologies Inc. and other
+// contributors
+//
+// All rights reserved.
+//
+// Author TPOC: contact@openfhe.org
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//==================================================================================
+
+#ifndef SRC_KEYS_H_
+#define SRC_KEYS_H_
+
+#include <memory>
+#include <string>
+
+#include "binfhecontext.h"
+
+// a crypto context with its secret key. the bootstrapping keys live in
+// the context, and copies of a KeySet share all of the key material.
+class KeySet {
+public:
+  lbcrypto::BinFHEContext cc;
+  lbcrypto::LWEPrivateKey sk;
+};
+
+// shared handle to one key set, used by every Circuit (and every gate
+// evaluation) under that key set, so the bootstrapping keys are held in
+// memory once however many circuits are loaded.
+//
+// thread safety: a key set is only written while it is generated or
+// loaded, before a handle is given out, and is const afterwards. the
+// context methods used to evaluate (Encrypt, Decrypt, EvalNOT,
+// EvalBinGate) are const, only read the parameters and keys, and return
+// new ciphertexts, so any number of threads in any number of Circuits
+// may call them at once on one shared context. do not call the key
+// generation or BTKeyLoad methods of a context that is shared.
+using KeySetPtr = std::shared_ptr<const KeySet>;
+
+// generate a new context, secret key and bootstrapping keys. with
+// lutInputs (3 or 4) the context is made for functional bootstrapping
+// with a plaintext space for LUT gates of that many inputs (see
+// LutMap()), and the boolean gates are not used. OpenFHE only supports
+// that with GINX and STD128 or TOY, so other choices are replaced.
+KeySet GenerateKeySet(lbcrypto::BINFHE_PARAMSET set,
+                      lbcrypto::BINFHE_METHOD method,
+                      unsigned int lutInputs = 0);
+
+// write a key set to directory dir (created if needed) / read it back.
+// both return false (after printing why) on any file error
+bool SaveKeySet(const std::string &dir, const KeySet &keys);
+bool LoadKeySet(const std::string &dir, KeySet *keys);
+
+// key store: returns the key set for set and method from storeDir,
+// generating and saving it on first use. an empty storeDir always
+// generates a new key set.
+KeySetPtr GetKeySet(const std::string &storeDir,
+                    lbcrypto::BINFHE_PARAMSET set,
+                    lbcrypto::BINFHE_METHOD method,
+                    unsigned int lutInputs = 0);
+
+#endif
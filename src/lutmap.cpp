@@ -0,0 +1,366 @@
+// @file lutmap.cpp -- map a circuit onto LUT gates evaluated by functional bootstrapping
+//==================================================================================
+// BSD 2-Clause License
+//
+// Copyright (c) 2014-2022, NJIT, Duality Technologies Inc. and other
+// contributors
+//
+// All rights reserved.
+//
+// Author TPOC: contact@openfhe.org
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//==================================================================================
+
+#include "lutmap.h"
+
+#include <algorithm>
+#include <iostream>
+
+// a cut of a node: leaves it can be computed from, and its function of
+// them as a 16 row truth table (leaf i is bit i of the row number)
+class LutCut {
+public:
+  unsigned int n_leaves;
+  WireId leaf[4]; // ascending
+  uint16_t tt;
+  double flow;        // area flow of the cut
+  unsigned int depth; // LUT levels to the cut, including its own
+};
+
+static const unsigned int MAX_LUT_CUTS = 12; // per node, best first
+static const uint16_t LUT_LEAF_TT[4] = {0xaaaa, 0xcccc, 0xf0f0, 0xff00};
+
+// truth table of cut c re expressed over the (larger) leaf set of u
+static uint16_t _Expand(const LutCut &c, const LutCut &u) {
+  unsigned int pos[4] = {0, 0, 0, 0};
+  for (unsigned int i = 0; i < c.n_leaves; i++) {
+    pos[i] = std::find(u.leaf, u.leaf + u.n_leaves, c.leaf[i]) - u.leaf;
+  }
+  uint16_t tt = 0;
+  for (unsigned int row = 0; row < 16; row++) {
+    unsigned int r = 0;
+    for (unsigned int i = 0; i < c.n_leaves; i++) {
+      r |= ((row >> pos[i]) & 1) << i;
+    }
+    tt |= ((c.tt >> r) & 1) << row;
+  }
+  return tt;
+}
+
+// drop the leaves the function does not depend on, keeping at least one
+static void _Shrink(LutCut &c) {
+  for (unsigned int i = c.n_leaves; (i-- > 0) && (c.n_leaves > 1);) {
+    unsigned int shift = 1 << i;
+    if (((c.tt ^ (c.tt >> shift)) & ~LUT_LEAF_TT[i] & 0xffff) != 0) {
+      continue;
+    }
+    // row r of the smaller cut is row r of c with a 0 inserted at bit i
+    uint16_t tt = 0;
+    for (unsigned int r = 0; r < 16; r++) {
+      unsigned int low = r & (shift - 1);
+      unsigned int row = low | ((r & ~(shift - 1)) << 1);
+      tt |= ((c.tt >> (row & 15)) & 1) << r;
+    }
+    std::copy(c.leaf + i + 1, c.leaf + c.n_leaves, c.leaf + i);
+    c.n_leaves--;
+    c.tt = tt;
+  }
+}
+
+std::shared_ptr<CompiledCircuit> LutMap(const CompiledCircuit &ckt,
+                                        unsigned int k) {
+  TIC(auto t_map);
+  const size_t n_wires = ckt.numberWires();
+  const WireId NONE = WireId(-1);
+  if ((k < 3) || (k > 4)) {
+    std::cerr << "LUT gates have 3 or 4 inputs, not " << k << std::endl;
+    exit(-1);
+  }
+
+  // a NOT only flips its input, so every wire is a literal of a base
+  // wire driven by an input or by a gate that is not a NOT
+  std::vector<WireId> base(n_wires);
+  std::vector<bool> inv(n_wires, false);
+  for (WireId w = 0; w < n_wires; w++) {
+    base[w] = w;
+  }
+  for (const auto &g : ckt.allGates) {
+    if (g.op == GateEnum::NOT) {
+      WireId o = g.outWires[0];
+      base[o] = base[g.inWires[0]];
+      inv[o] = !inv[g.inWires[0]];
+    }
+  }
+  // readers of each base wire, not counting NOTs
+  std::vector<unsigned int> refs(n_wires, 0);
+  for (const auto &g : ckt.allGates) {
+    if (g.op != GateEnum::NOT) {
+      for (auto iw : g.inWires) {
+        refs[base[iw]]++;
+      }
+    }
+  }
+
+  // enumerate the cuts of every base wire in program order, and pick the
+  // cut of least area flow (ties to the least depth) as we go. every cut
+  // is a LUT, so unlike TechMap() there is nothing to match. a node keeps
+  // its best cuts, ranked the same way, and its trivial cut, so the cuts
+  // kept do not depend on the order of the gate inputs.
+  std::vector<std::vector<LutCut>> cuts(n_wires);
+  std::vector<LutCut> best(n_wires);
+  std::vector<double> flow(n_wires, 0.0);
+  std::vector<unsigned int> depth(n_wires, 0);
+  auto trivial = [](WireId w) {
+    return LutCut{1, {w, 0, 0, 0}, LUT_LEAF_TT[0], 0.0, 0};
+  };
+  for (const auto &g : ckt.inputGates) {
+    for (auto o : g.outWires) {
+      cuts[o].push_back(trivial(o));
+    }
+  }
+  for (const auto &g : ckt.allGates) {
+    if ((g.op == GateEnum::NOT) || (g.op == GateEnum::OUTPUT)) {
+      continue;
+    }
+    size_t n_in = g.inWires.size();
+    bool two_input = (n_in == 2) &&
+                     ((g.op == GateEnum::AND) || (g.op == GateEnum::OR) ||
+                      (g.op == GateEnum::XOR) || (g.op == GateEnum::NAND) ||
+                      (g.op == GateEnum::NOR) || (g.op == GateEnum::XNOR));
+    bool three_input = (n_in == 3) && ((g.op == GateEnum::AND3) ||
+                                       (g.op == GateEnum::OR3) ||
+                                       (g.op == GateEnum::MAJORITY));
+    if ((g.outWires.size() != 1) || !(two_input || three_input)) {
+      std::cerr << "error LUT map cannot map gate " << g.getName()
+                << std::endl;
+      exit(-1);
+    }
+    WireId n = g.outWires[0];
+    // every combination of one cut from each input, counted like an
+    // odometer
+    std::vector<LutCut> found;
+    std::vector<size_t> pick(n_in, 0);
+    for (;;) {
+      WireId merged[12];
+      unsigned int n_merged = 0;
+      for (size_t i = 0; i < n_in; i++) {
+        const LutCut &ci = cuts[base[g.inWires[i]]][pick[i]];
+        n_merged = std::set_union(merged, merged + n_merged, ci.leaf,
+                                  ci.leaf + ci.n_leaves, merged + 4) -
+                   (merged + 4);
+        std::copy(merged + 4, merged + 4 + n_merged, merged);
+        if (n_merged > k) {
+          break;
+        }
+      }
+      if (n_merged <= k) {
+        LutCut u;
+        u.n_leaves = n_merged;
+        std::copy(merged, merged + n_merged, u.leaf);
+        uint16_t t[3];
+        for (size_t i = 0; i < n_in; i++) {
+          const LutCut &ci = cuts[base[g.inWires[i]]][pick[i]];
+          t[i] = _Expand(ci, u) ^ (inv[g.inWires[i]] ? 0xffff : 0);
+        }
+        switch (g.op) {
+        case (GateEnum::AND):
+          u.tt = t[0] & t[1];
+          break;
+        case (GateEnum::NAND):
+          u.tt = ~(t[0] & t[1]);
+          break;
+        case (GateEnum::OR):
+          u.tt = t[0] | t[1];
+          break;
+        case (GateEnum::NOR):
+          u.tt = ~(t[0] | t[1]);
+          break;
+        case (GateEnum::XOR):
+          u.tt = t[0] ^ t[1];
+          break;
+        case (GateEnum::XNOR):
+          u.tt = ~(t[0] ^ t[1]);
+          break;
+        case (GateEnum::AND3):
+          u.tt = t[0] & t[1] & t[2];
+          break;
+        case (GateEnum::OR3):
+          u.tt = t[0] | t[1] | t[2];
+          break;
+        default: // MAJORITY
+          u.tt = (t[0] & t[1]) | (t[2] & (t[0] | t[1]));
+          break;
+        }
+        _Shrink(u);
+        bool seen = false;
+        for (const auto &c : found) {
+          seen = seen || ((c.n_leaves == u.n_leaves) &&
+                          std::equal(c.leaf, c.leaf + c.n_leaves, u.leaf));
+        }
+        if (!seen) {
+          u.flow = 1.0;
+          u.depth = 0;
+          for (unsigned int i = 0; i < u.n_leaves; i++) {
+            u.flow += flow[u.leaf[i]] / std::max(refs[u.leaf[i]], 1u);
+            u.depth = std::max(u.depth, depth[u.leaf[i]]);
+          }
+          u.depth++;
+          found.push_back(u);
+        }
+      }
+      // next combination
+      size_t i = 0;
+      while ((i < n_in) && (++pick[i] == cuts[base[g.inWires[i]]].size())) {
+        pick[i++] = 0;
+      }
+      if (i == n_in) {
+        break;
+      }
+    }
+    // rank by area flow, then depth, then fewer leaves. the leaves break
+    // the last ties, so equal circuits rank their cuts alike
+    std::sort(found.begin(), found.end(),
+              [](const LutCut &a, const LutCut &b) {
+                if (a.flow != b.flow) {
+                  return a.flow < b.flow;
+                }
+                if (a.depth != b.depth) {
+                  return a.depth < b.depth;
+                }
+                if (a.n_leaves != b.n_leaves) {
+                  return a.n_leaves < b.n_leaves;
+                }
+                return std::lexicographical_compare(
+                    a.leaf, a.leaf + a.n_leaves, b.leaf, b.leaf + b.n_leaves);
+              });
+    best[n] = found[0];
+    flow[n] = found[0].flow;
+    depth[n] = found[0].depth;
+    if (found.size() > MAX_LUT_CUTS - 1) {
+      found.resize(MAX_LUT_CUTS - 1);
+    }
+    cuts[n].push_back(trivial(n));
+    cuts[n].insert(cuts[n].end(), found.begin(), found.end());
+  }
+
+  // keep the LUTs the outputs need, walking back from them
+  std::vector<bool> needed(n_wires, false);
+  std::vector<bool> isLeaf(n_wires, false); // read by a needed LUT
+  for (auto gid : ckt.outputGates) {
+    needed[base[ckt.allGates[gid].inWires[0]]] = true;
+  }
+  for (auto g = ckt.allGates.rbegin(); g != ckt.allGates.rend(); ++g) {
+    if ((g->op == GateEnum::NOT) || (g->op == GateEnum::OUTPUT) ||
+        !needed[g->outWires[0]]) {
+      continue;
+    }
+    const LutCut &b = best[g->outWires[0]];
+    for (unsigned int i = 0; i < b.n_leaves; i++) {
+      needed[b.leaf[i]] = true;
+      isLeaf[b.leaf[i]] = true;
+    }
+  }
+  // there is no free NOT at the LUT plaintext modulus. a LUT whose only
+  // readers are inverted outputs computes the inverse, any other inverted
+  // output gets a LUT of its own
+  std::vector<bool> readPlain(n_wires, false);
+  for (auto gid : ckt.outputGates) {
+    WireId w = ckt.allGates[gid].inWires[0];
+    readPlain[base[w]] = readPlain[base[w]] || !inv[w];
+  }
+  std::vector<bool> driven(n_wires, false);
+  for (const auto &g : ckt.allGates) {
+    if ((g.op != GateEnum::NOT) && (g.op != GateEnum::OUTPUT)) {
+      driven[g.outWires[0]] = true;
+    }
+  }
+  std::vector<bool> flipped(n_wires, false);
+  for (auto gid : ckt.outputGates) {
+    WireId w = ckt.allGates[gid].inWires[0];
+    WireId b = base[w];
+    if (inv[w]) {
+      flipped[b] = driven[b] && !isLeaf[b] && !readPlain[b];
+    }
+  }
+
+  // and write the mapped circuit
+  auto c = std::make_shared<CompiledCircuit>();
+  c->keepNames = ckt.keepNames;
+  for (WireId w = 0; w < n_wires; w++) {
+    c->addWire(ckt.keepNames ? ckt.wireNames[w] : "");
+  }
+  unsigned int n_before = 0, n_after = 0, n_lut3 = 0, n_lut4 = 0;
+  auto addLut = [&](const LutCut &cut, bool invert, WireId out) {
+    Gate lg;
+    lg.op = (cut.n_leaves == 4) ? GateEnum::LUT4 : GateEnum::LUT3;
+    lg.inWires.assign(cut.leaf, cut.leaf + cut.n_leaves);
+    lg.outWires.push_back(out);
+    uint16_t rows = (cut.n_leaves == 4) ? 0xffff
+                                        : ((1 << (1 << cut.n_leaves)) - 1);
+    lg.truthTable = (invert ? ~cut.tt : cut.tt) & rows;
+    n_after++;
+    n_lut3 += (lg.op == GateEnum::LUT3);
+    n_lut4 += (lg.op == GateEnum::LUT4);
+    c->addGate(std::move(lg));
+  };
+  for (const auto &g : ckt.inputGates) {
+    c->addGate(g);
+  }
+  std::vector<WireId> notWire(n_wires, NONE);
+  for (const auto &g : ckt.allGates) {
+    n_before += GateBootstraps(g.op);
+    if (g.op == GateEnum::OUTPUT) {
+      WireId w = g.inWires[0];
+      WireId b = base[w];
+      Gate o = g;
+      o.inWires[0] = b;
+      if (inv[w] && !flipped[b]) {
+        if (notWire[b] == NONE) {
+          notWire[b] = c->addWire(c->keepNames ? "~" + ckt.wireName(b) : "");
+          addLut(driven[b] ? best[b] : trivial(b), true, notWire[b]);
+        }
+        o.inWires[0] = notWire[b];
+      }
+      c->addGate(std::move(o));
+      continue;
+    }
+    if ((g.op == GateEnum::NOT) || !needed[g.outWires[0]]) {
+      continue;
+    }
+    WireId n = g.outWires[0];
+    addLut(best[n], flipped[n], n);
+  }
+  c->setOutputBits(ckt.n_output_bits);
+  c->copyPassFlags(ckt);
+  c->lutMapped = true;
+  c->finalize();
+  std::cout << "### LUT map " << n_before << " to " << n_after
+            << " bootstraps, " << n_lut3 << " LUT3 " << n_lut4
+            << " LUT4, plaintext modulus " << c->plaintextModulus
+            << ", critical path " << ckt.criticalPath << " to "
+            << c->criticalPath << ", " << TOC_MS(t_map) << " msec"
+            << std::endl;
+  return c;
+}
@@ -0,0 +1,53 @@
+// @file lutmap.h -- map a circuit onto LUT gates evaluated by functional bootstrapping
+//==================================================================================
+// BSD 2-Clause License
+//
+// Copyright (c) 2014-2022, NJIT, Duality Technologies Inc. and other
+// contributors
+//
+// All rights reserved.
+//
+// Author TPOC: contact@openfhe.org
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//==================================================================================
+#ifndef LUTMAP_H
+#define LUTMAP_H
+
+#include <memory>
+
+#include "compiled.h"
+
+// rewrite a circuit as a network of LUT gates of at most k (3 or 4)
+// inputs, each evaluated with one functional bootstrap. the gate graph
+// is covered with k feasible cuts chosen by area flow, and every cut
+// becomes one LUT3 or LUT4 gate holding its truth table. NOT gates are
+// absorbed into the tables. every wire of the result is encrypted with
+// the larger plaintext modulus LUTs need, so the result has no two input
+// gates at all and needs a key set made for functional bootstrapping
+// (GetKeySet() with lutInputs). inputs, outputs and wire ids are kept.
+std::shared_ptr<CompiledCircuit> LutMap(const CompiledCircuit &ckt,
+                                        unsigned int k);
+
+#endif
@@ -0,0 +1,704 @@
+// @file rewrite.cpp -- gate graph rewrites applied to a loaded circuit
+//==================================================================================
+// BSD 2-Clause License
+//
+// Copyright (c) 2014-2022, NJIT, Duality Technologies Inc. and other
+// contributors
+//
+// All rights reserved.
+//
+// Author TPOC: contact@openfhe.org
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//==================================================================================
+
+#include "rewrite.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <queue>
+#include <unordered_map>
+
+// the same gate with its output inverted, or the gate itself if it has
+// no inverse among the two input binfhe gates
+static GateEnum _Inverse(GateEnum op) {
+  switch (op) {
+  case (GateEnum::AND):
+    return GateEnum::NAND;
+  case (GateEnum::NAND):
+    return GateEnum::AND;
+  case (GateEnum::OR):
+    return GateEnum::NOR;
+  case (GateEnum::NOR):
+    return GateEnum::OR;
+  case (GateEnum::XOR):
+    return GateEnum::XNOR;
+  case (GateEnum::XNOR):
+    return GateEnum::XOR;
+  default:
+    return op;
+  }
+}
+
+// the same gate with both inputs inverted (De Morgan)
+static GateEnum _DeMorgan(GateEnum op) {
+  switch (op) {
+  case (GateEnum::AND):
+    return GateEnum::NOR;
+  case (GateEnum::NOR):
+    return GateEnum::AND;
+  case (GateEnum::OR):
+    return GateEnum::NAND;
+  case (GateEnum::NAND):
+    return GateEnum::OR;
+  default:
+    return op; // XOR and XNOR are unchanged
+  }
+}
+
+static bool _IsXor(GateEnum op) {
+  return (op == GateEnum::XOR) || (op == GateEnum::XNOR);
+}
+
+std::shared_ptr<CompiledCircuit> PushInversions(const CompiledCircuit &ckt) {
+  auto t_push = std::chrono::steady_clock::now();
+  const size_t n_wires = ckt.numberWires();
+  const WireId NONE = WireId(-1);
+
+  // every wire is a literal of a base wire driven by something other
+  // than a NOT
+  std::vector<WireId> base(n_wires);
+  std::vector<bool> inv(n_wires, false);
+  for (WireId w = 0; w < n_wires; w++) {
+    base[w] = w;
+  }
+  std::vector<bool> flippable(n_wires, false); // driven by a 2 input gate
+  for (const auto &g : ckt.allGates) {
+    if (g.op == GateEnum::NOT) {
+      WireId o = g.outWires[0];
+      base[o] = base[g.inWires[0]];
+      inv[o] = !inv[g.inWires[0]];
+    } else if ((g.outWires.size() == 1) && (_Inverse(g.op) != g.op)) {
+      flippable[g.outWires[0]] = true;
+    }
+  }
+
+  // a 2 input gate computes the inverse of its wire when more of the
+  // readers that care (XORs do not) read it inverted than not
+  std::vector<int> vote(n_wires, 0);
+  for (const auto &g : ckt.allGates) {
+    if ((g.op == GateEnum::NOT) || _IsXor(g.op)) {
+      continue;
+    }
+    for (auto iw : g.inWires) {
+      vote[base[iw]] += inv[iw] ? 1 : -1;
+    }
+  }
+  std::vector<bool> flipped(n_wires, false);
+  for (WireId w = 0; w < n_wires; w++) {
+    flipped[w] = flippable[w] && (vote[w] > 0);
+  }
+
+  auto c = std::make_shared<CompiledCircuit>();
+  c->keepNames = ckt.keepNames;
+  for (WireId w = 0; w < n_wires; w++) {
+    c->addWire(ckt.keepNames ? ckt.wireNames[w] : "");
+  }
+  // the NOTs still needed, one per base wire, reusing a wire of an old one
+  std::vector<WireId> notWire(n_wires, NONE);
+  for (WireId w = 0; w < n_wires; w++) {
+    if (inv[w] && (notWire[base[w]] == NONE)) {
+      notWire[base[w]] = w;
+    }
+  }
+  std::vector<bool> notDriven(n_wires, false);
+  unsigned int n_nots = 0;
+  auto inverted = [&](WireId b) {
+    if (notWire[b] == NONE) {
+      notWire[b] = c->addWire(c->keepNames ? "~" + ckt.wireName(b) : "");
+      notDriven.push_back(false);
+    }
+    WireId w = notWire[b];
+    if (!notDriven[w]) {
+      Gate g;
+      g.op = GateEnum::NOT;
+      g.inWires.push_back(b);
+      g.outWires.push_back(w);
+      c->addGate(std::move(g));
+      notDriven[w] = true;
+      n_nots++;
+    }
+    return w;
+  };
+
+  for (const auto &g : ckt.inputGates) {
+    c->addGate(g);
+  }
+  unsigned int n_old_nots = 0;
+  for (const auto &g : ckt.allGates) {
+    if (g.op == GateEnum::NOT) {
+      n_old_nots++;
+      continue;
+    }
+    Gate ng = g;
+    // which inputs read the opposite of what their wire now carries
+    std::vector<bool> wrong(g.inWires.size());
+    unsigned int n_wrong = 0;
+    for (size_t ix = 0; ix < g.inWires.size(); ix++) {
+      WireId iw = g.inWires[ix];
+      ng.inWires[ix] = base[iw];
+      wrong[ix] = (inv[iw] != flipped[base[iw]]);
+      n_wrong += wrong[ix];
+    }
+    if (_IsXor(g.op)) {
+      if (n_wrong % 2) {
+        ng.op = _Inverse(ng.op);
+      }
+      n_wrong = 0;
+    } else if ((n_wrong == 2) && (_DeMorgan(g.op) != g.op)) {
+      ng.op = _DeMorgan(ng.op);
+      n_wrong = 0;
+    }
+    if (n_wrong) {
+      for (size_t ix = 0; ix < ng.inWires.size(); ix++) {
+        if (wrong[ix]) {
+          ng.inWires[ix] = inverted(ng.inWires[ix]);
+        }
+      }
+    }
+    if ((g.outWires.size() == 1) && flipped[g.outWires[0]]) {
+      ng.op = _Inverse(ng.op);
+    }
+    c->addGate(std::move(ng));
+  }
+  c->setOutputBits(ckt.n_output_bits);
+  c->copyPassFlags(ckt);
+  c->inversionsPushed = true;
+  c->finalize();
+  std::cout << "### Pushed inversions, " << n_old_nots << " to " << n_nots
+            << " NOT gates, " << ckt.inputGates.size() + ckt.allGates.size()
+            << " to " << c->inputGates.size() + c->allGates.size()
+            << " gates, "
+            << std::chrono::duration_cast<std::chrono::milliseconds>(
+                   std::chrono::steady_clock::now() - t_push)
+                   .count()
+            << " msec" << std::endl;
+  return c;
+}
+
+// a node of the AIG style graph, its value is literal 2 * id and the
+// inverse 2 * id + 1. node 0 is the constant false.
+class AigNode {
+public:
+  GateEnum op;  // INPUT, AND, XOR, AND3, MAJORITY, or a gate kept as is
+  GateId gate;  // input gate or kept gate it stands for, else NONE
+  unsigned int outIx; // output wire of a kept gate it stands for
+  std::vector<uint32_t> lit; // input literals
+};
+
+class AigKeyHash {
+public:
+  size_t operator()(const std::array<uint32_t, 4> &k) const {
+    uint64_t h = 0;
+    for (auto x : k) {
+      h = (h ^ x) * 0x100000001b3ull;
+    }
+    return h ^ (h >> 29);
+  }
+};
+
+// builds the graph gate by gate. every gate is folded as far as its
+// inputs allow, then looked up in the table of nodes already built.
+class AigBuilder {
+public:
+  static const GateId NONE = GateId(-1);
+
+  AigBuilder() : n_hits(0) { Keep(GateEnum::INPUT, NONE, 0, {}); }
+
+  uint32_t And(uint32_t a, uint32_t b) {
+    if (a > b) {
+      std::swap(a, b);
+    }
+    if ((a == 0) || (a == (b ^ 1))) { // x & 0, x & !x
+      return 0;
+    }
+    if ((a == 1) || (a == b)) { // x & 1, x & x
+      return b;
+    }
+    return _Node(GateEnum::AND, {a, b});
+  }
+
+  uint32_t Xor(uint32_t a, uint32_t b) {
+    // inversions move to the output, so XOR and XNOR share nodes
+    uint32_t inv = (a ^ b) & 1;
+    a &= ~1u;
+    b &= ~1u;
+    if (a > b) {
+      std::swap(a, b);
+    }
+    if (a == 0) { // x ^ constant
+      return b ^ inv;
+    }
+    if (a == b) { // x ^ x
+      return inv;
+    }
+    return _Node(GateEnum::XOR, {a, b}) ^ inv;
+  }
+
+  uint32_t And3(uint32_t a, uint32_t b, uint32_t c) {
+    uint32_t l[3] = {a, b, c};
+    std::sort(l, l + 3);
+    if ((l[0] < 2) || ((l[0] | 1) == (l[1] | 1)) ||
+        ((l[1] | 1) == (l[2] | 1))) {
+      // a constant, repeated or opposite input, at most an AND of two
+      return And(And(l[0], l[1]), l[2]);
+    }
+    return _Node(GateEnum::AND3, {l[0], l[1], l[2]});
+  }
+
+  uint32_t Majority(uint32_t a, uint32_t b, uint32_t c) {
+    uint32_t l[3] = {a, b, c};
+    std::sort(l, l + 3);
+    if (l[0] < 2) { // maj(0, x, y) = x & y, maj(1, x, y) = x | y
+      uint32_t flip = l[0];
+      return And(l[1] ^ flip, l[2] ^ flip) ^ flip;
+    }
+    if ((l[0] == l[1]) || (l[1] == l[2])) { // maj(x, x, y) = x
+      return l[1];
+    }
+    if ((l[0] ^ 1) == l[1]) { // maj(x, !x, y) = y
+      return l[2];
+    }
+    if ((l[1] ^ 1) == l[2]) {
+      return l[0];
+    }
+    // self dual, so the first input is kept uninverted
+    uint32_t inv = l[0] & 1;
+    return _Node(GateEnum::MAJORITY, {l[0] ^ inv, l[1] ^ inv, l[2] ^ inv}) ^
+           inv;
+  }
+
+  // a node that is never merged: an input, or a gate kind not rewritten
+  uint32_t Keep(GateEnum op, GateId gate, unsigned int outIx,
+                std::vector<uint32_t> lit) {
+    AigNode n;
+    n.op = op;
+    n.gate = gate;
+    n.outIx = outIx;
+    n.lit = std::move(lit);
+    this->nodes.push_back(std::move(n));
+    return 2 * (this->nodes.size() - 1);
+  }
+
+  std::vector<AigNode> nodes;
+  unsigned int n_hits; // nodes found in the table
+
+private:
+  uint32_t _Node(GateEnum op, std::vector<uint32_t> lit) {
+    std::array<uint32_t, 4> key = {uint32_t(op), lit[0], lit[1],
+                                   (lit.size() > 2) ? lit[2] : 0};
+    auto found = this->table.find(key);
+    if (found != this->table.end()) {
+      this->n_hits++;
+      return found->second;
+    }
+    uint32_t l = Keep(op, NONE, 0, std::move(lit));
+    this->table.emplace(key, l);
+    return l;
+  }
+
+  std::unordered_map<std::array<uint32_t, 4>, uint32_t, AigKeyHash> table;
+};
+
+// a circuit as an AIG style graph, with its outputs
+class AigGraph {
+public:
+  AigGraph() : constSource(0) {}
+  AigBuilder aig;
+  std::vector<std::pair<GateId, uint32_t>> outputs; // output gate, literal
+  uint32_t constSource; // literal of a wire that is always false, or 0
+};
+
+// build the graph of a circuit, folding the constant inputs. returns the
+// bootstraps of the circuit, and adds those saved by folding and hashing
+static unsigned int _BuildAig(const CompiledCircuit &ckt,
+                              const ConstantInputs &constants, AigGraph &graph,
+                              unsigned int *n_folded, unsigned int *n_hashed) {
+  AigBuilder &aig = graph.aig;
+  std::vector<uint32_t> wireLit(ckt.numberWires(), 0);
+
+  // a declared constant input is read as the constant, but its input
+  // node stays and gives the constant a wire if one is needed
+  for (const auto &g : ckt.inputGates) {
+    uint32_t l = aig.Keep(GateEnum::INPUT, g.id, 0, {});
+    auto c = constants.find({g.ioBus, g.ioBit});
+    for (auto o : g.outWires) {
+      wireLit[o] = l;
+      if (c != constants.end()) {
+        wireLit[o] = c->second ? 1 : 0;
+        graph.constSource = l ^ wireLit[o];
+      }
+    }
+  }
+
+  unsigned int n_before = 0;
+  for (const auto &g : ckt.allGates) {
+    std::vector<uint32_t> in;
+    for (auto iw : g.inWires) {
+      in.push_back(wireLit[iw]);
+    }
+    size_t first_new = aig.nodes.size();
+    unsigned int hits = aig.n_hits;
+    uint32_t out = 0;
+    switch (g.op) {
+    case (GateEnum::OUTPUT):
+      graph.outputs.emplace_back(g.id, in[0]);
+      continue;
+    case (GateEnum::NOT):
+      out = in[0] ^ 1;
+      break;
+    case (GateEnum::AND):
+      out = aig.And(in[0], in[1]);
+      break;
+    case (GateEnum::NAND):
+      out = aig.And(in[0], in[1]) ^ 1;
+      break;
+    case (GateEnum::OR):
+      out = aig.And(in[0] ^ 1, in[1] ^ 1) ^ 1;
+      break;
+    case (GateEnum::NOR):
+      out = aig.And(in[0] ^ 1, in[1] ^ 1);
+      break;
+    case (GateEnum::XOR):
+      out = aig.Xor(in[0], in[1]);
+      break;
+    case (GateEnum::XNOR):
+      out = aig.Xor(in[0], in[1]) ^ 1;
+      break;
+    case (GateEnum::AND3):
+      out = aig.And3(in[0], in[1], in[2]);
+      break;
+    case (GateEnum::OR3):
+      out = aig.And3(in[0] ^ 1, in[1] ^ 1, in[2] ^ 1) ^ 1;
+      break;
+    case (GateEnum::MAJORITY):
+      out = aig.Majority(in[0], in[1], in[2]);
+      break;
+    default:
+      // kept as it is, with one node for each output wire
+      out = aig.Keep(g.op, g.id, 0, in);
+      for (size_t ix = 1; ix < g.outWires.size(); ix++) {
+        wireLit[g.outWires[ix]] = aig.Keep(g.op, g.id, ix, {});
+      }
+      break;
+    }
+    wireLit[g.outWires[0]] = out;
+    // a gate that found its node in the table saved a bootstrap by
+    // hashing, one that made no node at all by folding
+    unsigned int cost = GateBootstraps(g.op);
+    unsigned int made = 0;
+    for (size_t n = first_new; n < aig.nodes.size(); n++) {
+      made += GateBootstraps(aig.nodes[n].op);
+    }
+    unsigned int saved = cost - std::min(made, cost);
+    unsigned int by_hash = std::min(saved, aig.n_hits - hits);
+    n_before += cost;
+    *n_hashed += by_hash;
+    *n_folded += saved - by_hash;
+  }
+  return n_before;
+}
+
+// write the nodes of a graph that reach an output as a circuit with the
+// inputs and outputs of ckt. returns the bootstraps of gates dropped as
+// dead and of the new circuit.
+static std::shared_ptr<CompiledCircuit>
+_WriteAig(const CompiledCircuit &ckt, const AigGraph &graph,
+          unsigned int *n_dead, unsigned int *n_after) {
+  const AigBuilder &aig = graph.aig;
+  // keep the nodes the outputs need, walking back from them
+  std::vector<bool> needed(aig.nodes.size(), false);
+  for (const auto &o : graph.outputs) {
+    needed[o.second / 2] = true;
+  }
+  for (size_t n = aig.nodes.size(); n-- > 0;) {
+    if (needed[n]) {
+      needed[n - aig.nodes[n].outIx] = true; // a kept gate has all outputs
+      for (auto l : aig.nodes[n].lit) {
+        needed[l / 2] = true;
+      }
+    }
+  }
+  *n_dead = 0;
+  for (size_t n = 1; n < aig.nodes.size(); n++) {
+    if (!needed[n] && (aig.nodes[n].outIx == 0)) {
+      *n_dead += GateBootstraps(aig.nodes[n].op);
+    }
+  }
+
+  // one wire per node
+  auto c = std::make_shared<CompiledCircuit>();
+  c->keepNames = ckt.keepNames;
+  const WireId NO_WIRE = WireId(-1);
+  std::vector<WireId> nodeWire(aig.nodes.size(), NO_WIRE);
+  std::vector<WireId> notWire(aig.nodes.size(), NO_WIRE);
+  *n_after = 0;
+  std::function<WireId(uint32_t)> literal = [&](uint32_t l) -> WireId {
+    size_t n = l / 2;
+    if ((n == 0) && (nodeWire[0] == NO_WIRE)) { // made on first use
+      if (graph.constSource >= 2) {
+        nodeWire[0] = literal(graph.constSource);
+      } else {
+        // no constant input to take it from, x ^ x of the first input
+        Gate g;
+        g.op = GateEnum::XOR;
+        g.inWires = {nodeWire[1], nodeWire[1]};
+        nodeWire[0] = c->addWire("zero");
+        g.outWires.push_back(nodeWire[0]);
+        c->addGate(std::move(g));
+        (*n_after)++;
+      }
+    }
+    if ((l & 1) == 0) {
+      return nodeWire[n];
+    }
+    if (notWire[n] == NO_WIRE) {
+      Gate g;
+      g.op = GateEnum::NOT;
+      g.inWires.push_back(nodeWire[n]);
+      notWire[n] = c->addWire("");
+      g.outWires.push_back(notWire[n]);
+      c->addGate(std::move(g));
+    }
+    return notWire[n];
+  };
+  for (size_t n = 1; n < aig.nodes.size(); n++) {
+    if (aig.nodes[n].op == GateEnum::INPUT) {
+      Gate g = ckt.inputGates[aig.nodes[n].gate];
+      nodeWire[n] = c->addWire(
+          ckt.keepNames ? ckt.wireNames[g.outWires[0]] : "");
+      g.outWires = {nodeWire[n]};
+      c->addGate(std::move(g));
+    }
+  }
+  for (size_t n = 1; n < aig.nodes.size(); n++) {
+    const AigNode &node = aig.nodes[n];
+    if ((node.op == GateEnum::INPUT) || !needed[n] || (node.outIx != 0)) {
+      continue;
+    }
+    Gate g;
+    g.op = node.op;
+    for (auto l : node.lit) {
+      g.inWires.push_back(literal(l));
+    }
+    size_t n_out = 1;
+    if (node.gate != AigBuilder::NONE) { // kept as it is
+      const Gate &kg = ckt.allGates[node.gate];
+      g.ioBus = kg.ioBus;
+      g.ioBit = kg.ioBit;
+      n_out = kg.outWires.size();
+    }
+    for (size_t ix = 0; ix < n_out; ix++) {
+      nodeWire[n + ix] = c->addWire("");
+      g.outWires.push_back(nodeWire[n + ix]);
+    }
+    *n_after += GateBootstraps(g.op);
+    c->addGate(std::move(g));
+  }
+  for (const auto &o : graph.outputs) {
+    Gate g = ckt.allGates[o.first];
+    g.inWires = {literal(o.second)};
+    c->addGate(std::move(g));
+  }
+  c->setOutputBits(ckt.n_output_bits);
+  c->copyPassFlags(ckt);
+  c->finalize();
+  return c;
+}
+
+static long _MsecSince(std::chrono::steady_clock::time_point t) {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+             std::chrono::steady_clock::now() - t)
+      .count();
+}
+
+// LUT gates are opaque to the AND/XOR graph, and their wires are at a
+// larger plaintext modulus than the gates it writes
+static bool _HasLuts(const CompiledCircuit &ckt, const std::string &pass) {
+  if (ckt.plaintextModulus > 4) {
+    std::cout << "### " << pass << " skipped, the circuit has LUT gates"
+              << std::endl;
+    return true;
+  }
+  return false;
+}
+
+std::shared_ptr<CompiledCircuit> Optimize(const CompiledCircuit &ckt,
+                                          const ConstantInputs &constants) {
+  if (_HasLuts(ckt, "Optimize")) {
+    return std::make_shared<CompiledCircuit>(ckt);
+  }
+  auto t_opt = std::chrono::steady_clock::now();
+  AigGraph graph;
+  unsigned int n_folded = 0, n_hashed = 0, n_dead = 0, n_after = 0;
+  unsigned int n_before =
+      _BuildAig(ckt, constants, graph, &n_folded, &n_hashed);
+  auto c = _WriteAig(ckt, graph, &n_dead, &n_after);
+  std::cout << "### Optimized " << n_before << " to " << n_after
+            << " bootstraps: " << n_folded << " saved by folding constants, "
+            << n_hashed << " by hashing, " << n_dead << " dead gates removed, "
+            << _MsecSince(t_opt) << " msec" << std::endl;
+  auto pushed = PushInversions(*c);
+  pushed->optimized = true;
+  return pushed;
+}
+
+std::shared_ptr<CompiledCircuit> Rebalance(const CompiledCircuit &ckt) {
+  if (_HasLuts(ckt, "Rebalance")) {
+    return std::make_shared<CompiledCircuit>(ckt);
+  }
+  auto t_bal = std::chrono::steady_clock::now();
+  AigGraph old_graph;
+  unsigned int n_folded = 0, n_hashed = 0;
+  _BuildAig(ckt, ConstantInputs(), old_graph, &n_folded, &n_hashed);
+  const AigBuilder &old_aig = old_graph.aig;
+  const size_t n_nodes = old_aig.nodes.size();
+
+  // an AND (XOR) node read only by one AND (XOR) node is inside a chain,
+  // for AND only through an uninverted edge. XOR takes inversions to its
+  // output, so any edge will do.
+  std::vector<unsigned int> readers(n_nodes, 0);
+  std::vector<bool> inner(n_nodes, false);
+  for (const auto &o : old_graph.outputs) {
+    readers[o.second / 2]++;
+  }
+  for (size_t n = 1; n < n_nodes; n++) {
+    for (auto l : old_aig.nodes[n].lit) {
+      readers[l / 2]++;
+    }
+  }
+  auto chains = [&](GateEnum op, uint32_t l) {
+    const AigNode &child = old_aig.nodes[l / 2];
+    return (child.op == op) && (child.gate == AigBuilder::NONE) &&
+           (readers[l / 2] == 1) && ((op == GateEnum::XOR) || !(l & 1));
+  };
+  for (size_t n = 1; n < n_nodes; n++) {
+    const AigNode &node = old_aig.nodes[n];
+    if ((node.op == GateEnum::AND) || (node.op == GateEnum::XOR)) {
+      for (auto l : node.lit) {
+        inner[l / 2] = inner[l / 2] || chains(node.op, l);
+      }
+    }
+  }
+
+  // rebuild in order. the root of each chain collects the leaves of the
+  // chain and combines the two that are ready first until one is left,
+  // which gives the least depth for the same number of gates
+  AigGraph graph;
+  AigBuilder &aig = graph.aig;
+  std::vector<uint32_t> newLit(n_nodes, 0);
+  std::vector<unsigned int> depth(1, 0); // of each new node
+  auto depthOf = [&](uint32_t l) {
+    for (size_t n = depth.size(); n < aig.nodes.size(); n++) {
+      unsigned int d = 0;
+      for (auto in : aig.nodes[n].lit) {
+        d = std::max(d, depth[in / 2]);
+      }
+      depth.push_back(d + GateBootstraps(aig.nodes[n].op));
+    }
+    return depth[l / 2];
+  };
+  auto mapped = [&](uint32_t l) { return newLit[l / 2] ^ (l & 1); };
+  unsigned int n_chains = 0;
+  for (size_t n = 1; n < n_nodes; n++) {
+    const AigNode &node = old_aig.nodes[n];
+    if (inner[n]) {
+      continue; // built by the root of its chain
+    }
+    if (node.op == GateEnum::INPUT) {
+      newLit[n] = aig.Keep(GateEnum::INPUT, node.gate, 0, {});
+      continue;
+    }
+    std::vector<uint32_t> in;
+    for (auto l : node.lit) {
+      in.push_back(mapped(l));
+    }
+    if (node.gate != AigBuilder::NONE) {
+      newLit[n] = aig.Keep(node.op, node.gate, node.outIx, in);
+    } else if (node.op == GateEnum::AND3) {
+      newLit[n] = aig.And3(in[0], in[1], in[2]);
+    } else if (node.op == GateEnum::MAJORITY) {
+      newLit[n] = aig.Majority(in[0], in[1], in[2]);
+    } else {
+      // collect the leaves of the chain, XOR inversions go to the output
+      uint32_t flip = 0;
+      std::vector<uint32_t> leaves;
+      std::vector<uint32_t> stack(node.lit.begin(), node.lit.end());
+      while (!stack.empty()) {
+        uint32_t l = stack.back();
+        stack.pop_back();
+        if (inner[l / 2] && chains(node.op, l)) {
+          flip ^= l & 1;
+          const auto &lits = old_aig.nodes[l / 2].lit;
+          stack.insert(stack.end(), lits.begin(), lits.end());
+        } else {
+          leaves.push_back(mapped(l));
+        }
+      }
+      n_chains += (leaves.size() > 2);
+      using Ready = std::pair<unsigned int, uint32_t>; // depth, literal
+      std::priority_queue<Ready, std::vector<Ready>, std::greater<Ready>> q;
+      for (auto l : leaves) {
+        q.emplace(depthOf(l), l);
+      }
+      while (q.size() > 1) {
+        uint32_t a = q.top().second;
+        q.pop();
+        uint32_t b = q.top().second;
+        q.pop();
+        uint32_t l = (node.op == GateEnum::AND) ? aig.And(a, b)
+                                                : aig.Xor(a, b);
+        q.emplace(depthOf(l), l);
+      }
+      newLit[n] = q.top().second ^ flip;
+    }
+  }
+  for (const auto &o : old_graph.outputs) {
+    graph.outputs.emplace_back(o.first, mapped(o.second));
+  }
+  graph.constSource = old_graph.constSource;
+
+  unsigned int n_dead = 0, n_after = 0;
+  auto c = _WriteAig(ckt, graph, &n_dead, &n_after);
+  auto pushed = PushInversions(*c);
+  pushed->rebalanced = true;
+  std::cout << "### Rebalanced " << n_chains << " chains: critical path "
+            << ckt.criticalPath << " to " << pushed->criticalPath
+            << " bootstraps, " << n_after << " bootstraps in all, "
+            << _MsecSince(t_bal) << " msec" << std::endl;
+  return pushed;
+}
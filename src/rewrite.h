@@ -0,0 +1,75 @@
+// @file rewrite.h -- gate graph rewrites applied to a loaded circuit
+//==================================================================================
+// BSD 2-Clause License
+//
+// Copyright (c) 2014-2022, NJIT, Duality Technologies Inc. and other
+// contributors
+//
+// All rights reserved.
+//
+// Author TPOC: contact@openfhe.org
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//==================================================================================
+
+#ifndef REWRITE_H
+#define REWRITE_H
+
+#include <map>
+#include <memory>
+#include <utility>
+
+#include "compiled.h"
+
+// input bits known to be constant, (bus, bit) -> value
+using ConstantInputs = std::map<std::pair<unsigned int, unsigned int>, unsigned int>;
+
+// remove NOT gates. an inverted input of XOR or XNOR flips the gate, two
+// inverted inputs of AND, OR, NAND or NOR swap it by De Morgan, and a gate
+// whose readers mostly want its output inverted computes the inverse
+// instead (AND to NAND and so on). a NOT is kept only where none of these
+// apply: a single inverted input of AND or OR, an inverted circuit output
+// of an input wire, or an input of another kind of gate.
+std::shared_ptr<CompiledCircuit> PushInversions(const CompiledCircuit &ckt);
+
+// AIG style clean up. NOTs become inverted edges, OR, NAND and NOR become
+// AND and XNOR becomes XOR, so equal logic looks equal. then
+// - constant inputs are folded through the gates they feed, as are
+//   gates with equal or opposite inputs
+// - gates computing the same function of the same inputs are merged
+//   (structural hashing)
+// - gates that reach no output are dropped
+// and the result is written back through PushInversions(). the input
+// gates are all kept, constant or not, so the inputs do not change.
+std::shared_ptr<CompiledCircuit> Optimize(const CompiledCircuit &ckt,
+                                          const ConstantInputs &constants);
+
+// rebuild chains of AND (OR, NAND, NOR) or XOR (XNOR) gates, where each
+// gate is read only by the next, as balanced trees. the leaves that are
+// ready first are combined first, so the depth of each chain is the least
+// possible for the same number of gates. runs on the same graph as
+// Optimize(), so equal gates are merged too.
+std::shared_ptr<CompiledCircuit> Rebalance(const CompiledCircuit &ckt);
+
+#endif
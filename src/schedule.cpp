@@ -0,0 +1,104 @@
+// @file schedule.cpp -- ready gate queue for encrypted circuit evaluation
+//==================================================================================
+// BSD 2-Clause License
+//
+// Copyright (c) 2014-2022, NJIT, Duality Technologies Inc. and other
+// contributors
+//
+// All rights reserved.
+//
+// Author TPOC: contact@openfhe.org
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//==================================================================================
+#include "schedule.h"
+
+#include <algorithm>
+
+ReadyQueue::ReadyQueue(void) : priority(nullptr) {}
+
+ReadyQueue::~ReadyQueue(void) {}
+
+void ReadyQueue::setPriority(const std::vector<unsigned int> *p) {
+  // drain any queued gates into the new ordering
+  std::vector<GateId> queued;
+  while (!this->empty()) {
+    queued.push_back(this->pop());
+  }
+  this->priority = p;
+  for (auto g : queued) {
+    this->push(g);
+  }
+}
+
+bool ReadyQueue::isFIFO(void) const { return this->priority == nullptr; }
+
+bool ReadyQueue::_before(GateId a, GateId b) const {
+  const auto &p = *this->priority;
+  if (p[a] != p[b]) {
+    return p[a] < p[b];
+  }
+  return a > b;
+}
+
+void ReadyQueue::push(GateId g) {
+  if (this->isFIFO()) {
+    this->fifo.push_back(g);
+    return;
+  }
+  this->heap.push_back(g);
+  std::push_heap(this->heap.begin(), this->heap.end(),
+                 [this](GateId a, GateId b) { return _before(a, b); });
+}
+
+GateId ReadyQueue::pop(void) {
+  GateId g;
+  if (this->isFIFO()) {
+    g = this->fifo.front();
+    this->fifo.pop_front();
+    return g;
+  }
+  std::pop_heap(this->heap.begin(), this->heap.end(),
+                [this](GateId a, GateId b) { return _before(a, b); });
+  g = this->heap.back();
+  this->heap.pop_back();
+  return g;
+}
+
+GateId ReadyQueue::top(void) const {
+  return this->isFIFO() ? this->fifo.front() : this->heap.front();
+}
+
+bool ReadyQueue::empty(void) const {
+  return this->fifo.empty() && this->heap.empty();
+}
+
+size_t ReadyQueue::size(void) const {
+  return this->fifo.size() + this->heap.size();
+}
+
+void ReadyQueue::clear(void) {
+  this->fifo.clear();
+  this->heap.clear();
+}
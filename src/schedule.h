@@ -0,0 +1,66 @@
+// @file schedule.h -- ready gate queue for encrypted circuit evaluation
+//==================================================================================
+// BSD 2-Clause License
+//
+// Copyright (c) 2014-2022, NJIT, Duality Technologies Inc. and other
+// contributors
+//
+// All rights reserved.
+//
+// Author TPOC: contact@openfhe.org
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//==================================================================================
+
+#ifndef SCHEDULE_H
+#define SCHEDULE_H
+
+#include "wire.h"
+#include <deque>
+#include <vector>
+
+// queue of gates that are ready to execute. gates are either popped in
+// the order they became ready (FIFO) or, when a priority table indexed
+// by GateId is set, highest priority first (ties go to the lower GateId).
+class ReadyQueue {
+public:
+  ReadyQueue();
+  ~ReadyQueue();
+  void setPriority(const std::vector<unsigned int> *p); // nullptr is FIFO
+  bool isFIFO(void) const;
+  void push(GateId g);
+  GateId pop(void);
+  GateId top(void) const; // the gate pop() would return
+  bool empty(void) const;
+  size_t size(void) const;
+  void clear(void);
+
+private:
+  bool _before(GateId a, GateId b) const; // heap order, true if a below b
+  const std::vector<unsigned int> *priority;
+  std::deque<GateId> fifo;
+  std::vector<GateId> heap;
+};
+
+#endif
@@ -0,0 +1,271 @@
+// @file stream.cpp -- pipelined evaluation of a stream of requests
+//==================================================================================
+// BSD 2-Clause License
+//
+// Copyright (c) 2014-2022, NJIT, Duality Technologies Inc. and other
+// contributors
+//
+// All rights reserved.
+//
+// Author TPOC: contact@openfhe.org
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//==================================================================================
+#include "stream.h"
+
+#include <algorithm>
+#include <iostream>
+#include <omp.h>
+
+bool CircuitStream::WorkItem::operator<(const WorkItem &o) const {
+  // std::priority_queue pops the largest item: the oldest request, then
+  // the gate with the most bootstraps left on its path to an output
+  if (this->seq != o.seq) {
+    return this->seq > o.seq;
+  }
+  if (this->height != o.height) {
+    return this->height < o.height;
+  }
+  return this->gid > o.gid;
+}
+
+CircuitStream::CircuitStream(KeySetPtr keys,
+                             std::shared_ptr<const CompiledCircuit> ckt,
+                             unsigned int depth, unsigned int queueSize)
+    : ckt(ckt), queueSize(std::max(queueSize, 1u)), shutdown(false),
+      n_submitted(0), n_completed(0), n_stalled(0) {
+  depth = std::max(depth, 1u);
+  for (unsigned int s = 0; s < depth; s++) {
+    this->slots.emplace_back(new Circuit(keys));
+    this->slots.back()->Load(ckt);
+  }
+  this->inFlight.resize(depth);
+  this->slotBusy.assign(depth, false);
+  this->slotQueued.assign(depth, 0);
+  this->slotRunning.assign(depth, 0);
+  // one worker per OMP thread, each worker evaluates one gate at a time
+  int n_workers = omp_get_max_threads();
+  for (int w = 0; w < n_workers; w++) {
+    this->workers.emplace_back(&CircuitStream::_Worker, this);
+  }
+}
+
+CircuitStream::~CircuitStream(void) {
+  this->Drain();
+  {
+    std::lock_guard<std::mutex> lock(this->mtx);
+    this->shutdown = true;
+  }
+  this->workCv.notify_all();
+  for (auto &w : this->workers) {
+    w.join();
+  }
+}
+
+void CircuitStream::Submit(Inputs input, Callback done) {
+  std::unique_lock<std::mutex> lock(this->mtx);
+  this->spaceCv.wait(lock, [&] {
+    return this->submitQueue.size() < this->queueSize;
+  });
+  Request r;
+  r.seq = this->n_submitted++;
+  r.input = std::move(input);
+  r.done = std::move(done);
+  r.submitted = std::chrono::steady_clock::now();
+  if (r.seq == 0) {
+    this->t_first = r.submitted;
+  }
+  this->submitQueue.push_back(std::move(r));
+  this->workCv.notify_one();
+}
+
+std::future<Outputs> CircuitStream::Submit(Inputs input) {
+  auto promise = std::make_shared<std::promise<Outputs>>();
+  auto future = promise->get_future();
+  this->Submit(std::move(input),
+               [promise](Outputs out) { promise->set_value(std::move(out)); });
+  return future;
+}
+
+void CircuitStream::Drain(void) {
+  std::unique_lock<std::mutex> lock(this->mtx);
+  this->idleCv.wait(lock,
+                    [&] { return this->n_completed == this->n_submitted; });
+}
+
+void CircuitStream::_Worker(void) {
+  // gates are the unit of parallelism here, do not nest OMP teams in
+  // the encryption and decryption loops of the slot circuits
+  omp_set_num_threads(1);
+  std::unique_lock<std::mutex> lock(this->mtx);
+  while (true) {
+    if (_Admit(lock)) {
+      continue;
+    }
+    if (this->ready.empty()) {
+      if (this->shutdown) {
+        break;
+      }
+      this->workCv.wait(lock);
+      continue;
+    }
+    WorkItem w = this->ready.top();
+    this->ready.pop();
+    this->slotQueued[w.slot]--;
+    this->slotRunning[w.slot]++;
+    Circuit &c = *this->slots[w.slot];
+    lock.unlock();
+
+    c.EvaluateGate(w.gid);
+
+    lock.lock();
+    this->slotRunning[w.slot]--;
+    c.RetireGate(w.gid);
+    _Step(w.slot, lock);
+  }
+}
+
+bool CircuitStream::_Admit(std::unique_lock<std::mutex> &lock) {
+  // move the oldest submitted request into a free slot. returns false if
+  // there is no request or no free slot. called with the lock held, the
+  // inputs are encrypted without it.
+  if (this->submitQueue.empty()) {
+    return false;
+  }
+  auto free_slot =
+      std::find(this->slotBusy.begin(), this->slotBusy.end(), false);
+  if (free_slot == this->slotBusy.end()) {
+    return false;
+  }
+  unsigned int slot = free_slot - this->slotBusy.begin();
+  this->slotBusy[slot] = true;
+  this->inFlight[slot] = std::move(this->submitQueue.front());
+  this->submitQueue.pop_front();
+  this->spaceCv.notify_one();
+  Circuit &c = *this->slots[slot];
+  lock.unlock();
+
+  c.Reset();
+  c.setEncrypted(true);
+  c.SetInput(this->inFlight[slot].input);
+
+  lock.lock();
+  _Step(slot, lock);
+  return true;
+}
+
+void CircuitStream::_Step(unsigned int slot,
+                          std::unique_lock<std::mutex> &lock) {
+  // queue the gates a slot just made ready, and finish its request when
+  // no gates are left. with gates left but none queued or running, no
+  // gate of the slot will ever retire again: the pipeline is stalled.
+  // report it and give the request back rather than wait forever.
+  _QueueReady(slot);
+  size_t n_left = this->slots[slot]->GatesLeft();
+  if (n_left == 0) {
+    _Finish(slot, lock);
+  } else if (!this->slotQueued[slot] && !this->slotRunning[slot]) {
+    std::cerr << "error in stream evaluation: request "
+              << this->inFlight[slot].seq << " stalled, " << n_left
+              << " gates can never become ready" << std::endl;
+    _Finish(slot, lock, true);
+  }
+}
+
+void CircuitStream::_QueueReady(unsigned int slot) {
+  // move the gates a slot just made ready onto the shared queue
+  uint64_t seq = this->inFlight[slot].seq;
+  auto gids = this->slots[slot]->ReadyGates();
+  for (auto gid : gids) {
+    this->ready.push({seq, this->ckt->gateHeight[gid], slot, gid});
+  }
+  this->slotQueued[slot] += gids.size();
+  if (!gids.empty()) {
+    this->workCv.notify_all();
+  }
+}
+
+void CircuitStream::_Finish(unsigned int slot,
+                            std::unique_lock<std::mutex> &lock,
+                            bool stalled) {
+  // the last gate of a slot is done: decrypt its outputs and hand them
+  // back without the lock, then free the slot. a stalled request gets
+  // empty outputs.
+  Circuit &c = *this->slots[slot];
+  Request r = std::move(this->inFlight[slot]);
+  lock.unlock();
+
+  Outputs out;
+  if (!stalled) {
+    out = c.DecryptOutputs()[0];
+  }
+  auto finished = std::chrono::steady_clock::now();
+  if (r.done) {
+    r.done(std::move(out));
+  }
+
+  lock.lock();
+  this->latencies_ms.push_back(
+      std::chrono::duration<double, std::milli>(finished - r.submitted)
+          .count());
+  this->t_last = std::max(this->t_last, finished);
+  this->n_completed++;
+  this->n_stalled += stalled;
+  this->slotBusy[slot] = false;
+  this->workCv.notify_all();
+  this->idleCv.notify_all();
+}
+
+void CircuitStream::Report(void) {
+  // futures resolve before their request is counted, so drain first
+  this->Drain();
+  std::lock_guard<std::mutex> lock(this->mtx);
+  if (this->latencies_ms.empty()) {
+    std::cout << "### Stream: no requests completed" << std::endl;
+    return;
+  }
+  auto lat = this->latencies_ms;
+  std::sort(lat.begin(), lat.end());
+  auto pct = [&](double p) {
+    size_t ix = std::min(lat.size() - 1, size_t(p / 100.0 * lat.size()));
+    return lat[ix];
+  };
+  double elapsed_ms = std::chrono::duration<double, std::milli>(
+                          this->t_last - this->t_first)
+                          .count();
+  if (elapsed_ms <= 0.0) {
+    elapsed_ms = 1.0;
+  }
+  std::cout << "### Stream throughput " << lat.size() / elapsed_ms * 1000.0
+            << " requests/sec for " << lat.size() << " requests, "
+            << this->slots.size() << " in flight, " << this->workers.size()
+            << " workers" << std::endl;
+  std::cout << "### Stream latency msec p50 " << pct(50) << " p90 "
+            << pct(90) << " p99 " << pct(99) << " max " << lat.back()
+            << std::endl;
+  if (this->n_stalled) {
+    std::cout << "### Stream " << this->n_stalled
+              << " requests stalled, returned without outputs" << std::endl;
+  }
+}
@@ -0,0 +1,125 @@
+// @file stream.h -- pipelined evaluation of a stream of requests
+//==================================================================================
+// BSD 2-Clause License
+//
+// Copyright (c) 2014-2022, NJIT, Duality Technologies Inc. and other
+// contributors
+//
+// All rights reserved.
+//
+// Author TPOC: contact@openfhe.org
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//==================================================================================
+
+#ifndef SRC_STREAM_H_
+#define SRC_STREAM_H_
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+#include "circuit.h"
+
+// encrypted evaluation of a continuous stream of requests on one circuit.
+// requests are submitted to a bounded queue and up to depth of them are
+// in flight at once, each in its own slot Circuit. all worker threads
+// share one ready queue of (request, gate) work items ordered oldest
+// request first, then critical path first, so a new request starts its
+// first levels on cores that the last levels of older requests leave
+// idle. outputs are returned through a callback or a future.
+class CircuitStream {
+public:
+  using Callback = std::function<void(Outputs)>;
+
+  CircuitStream(KeySetPtr keys, std::shared_ptr<const CompiledCircuit> ckt,
+                unsigned int depth = 4, unsigned int queueSize = 16);
+  ~CircuitStream(); // finishes all submitted requests
+
+  // both block while the submit queue is full. the callback runs on a
+  // worker thread. a request whose gates can never all run (a broken
+  // circuit) is reported and completes with empty outputs
+  void Submit(Inputs input, Callback done);
+  std::future<Outputs> Submit(Inputs input);
+  void Drain(void); // wait until every submitted request is done
+  void Report(void); // drains, then prints throughput and latency percentiles
+
+private:
+  class Request {
+  public:
+    uint64_t seq; // submission order
+    Inputs input;
+    Callback done;
+    std::chrono::steady_clock::time_point submitted;
+  };
+  class WorkItem {
+  public:
+    uint64_t seq;
+    unsigned int height;
+    unsigned int slot;
+    GateId gid;
+    bool operator<(const WorkItem &o) const; // for the max heap
+  };
+
+  void _Worker(void);
+  bool _Admit(std::unique_lock<std::mutex> &lock);
+  void _QueueReady(unsigned int slot);
+  void _Step(unsigned int slot, std::unique_lock<std::mutex> &lock);
+  void _Finish(unsigned int slot, std::unique_lock<std::mutex> &lock,
+               bool stalled = false);
+
+  std::shared_ptr<const CompiledCircuit> ckt;
+  std::vector<std::unique_ptr<Circuit>> slots;
+  std::vector<Request> inFlight; // request held by each slot
+  std::vector<bool> slotBusy;
+  std::vector<size_t> slotQueued;  // work items of a slot in ready
+  std::vector<size_t> slotRunning; // work items of a slot being evaluated
+
+  std::mutex mtx;
+  std::condition_variable workCv;  // work, a free slot or shutdown
+  std::condition_variable spaceCv; // room in the submit queue
+  std::condition_variable idleCv;  // a request finished
+  std::deque<Request> submitQueue;
+  unsigned int queueSize;
+  std::priority_queue<WorkItem> ready;
+  std::vector<std::thread> workers;
+  bool shutdown;
+
+  uint64_t n_submitted;
+  uint64_t n_completed;
+  uint64_t n_stalled; // completed without outputs, see _Step()
+  std::chrono::steady_clock::time_point t_first; // first submission
+  std::chrono::steady_clock::time_point t_last;  // last completion
+  std::vector<double> latencies_ms;              // per completed request
+};
+
+#endif
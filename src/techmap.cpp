@@ -0,0 +1,360 @@
+// @file techmap.cpp -- map a circuit onto the multi input gates of binfhe
+//==================================================================================
+// BSD 2-Clause License
+//
+// Copyright (c) 2014-2022, NJIT, Duality Technologies Inc. and other
+// contributors
+//
+// All rights reserved.
+//
+// Author TPOC: contact@openfhe.org
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//==================================================================================
+
+#include "techmap.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+// a cut of a node: leaves it can be computed from, and its function of
+// them as an 8 row truth table (leaf i is bit i of the row number)
+class Cut {
+public:
+  unsigned int n_leaves;
+  WireId leaf[3]; // ascending
+  uint8_t tt;
+};
+
+// a gate computing a node from its leaves, each leaf possibly inverted
+class Match {
+public:
+  GateEnum op;
+  WireIdList leaf;
+  std::vector<bool> inverted;
+};
+
+static const unsigned int MAX_CUTS = 16; // per node
+static const uint8_t LEAF_TT[3] = {0xaa, 0xcc, 0xf0};
+
+// truth table of cut c re expressed over the (larger) leaf set of u
+static uint8_t _Expand(const Cut &c, const Cut &u) {
+  unsigned int pos[3] = {0, 0, 0};
+  for (unsigned int i = 0; i < c.n_leaves; i++) {
+    pos[i] = std::find(u.leaf, u.leaf + u.n_leaves, c.leaf[i]) - u.leaf;
+  }
+  uint8_t tt = 0;
+  for (unsigned int row = 0; row < 8; row++) {
+    unsigned int r = 0;
+    for (unsigned int i = 0; i < c.n_leaves; i++) {
+      r |= ((row >> pos[i]) & 1) << i;
+    }
+    tt |= ((c.tt >> r) & 1) << row;
+  }
+  return tt;
+}
+
+// true if the function does not change with leaf i
+static bool _Ignores(uint8_t tt, unsigned int i) {
+  unsigned int shift = 1 << i;
+  return ((tt ^ (tt >> shift)) & ~LEAF_TT[i] & 0xff) == 0;
+}
+
+// the binfhe gate (with inverted inputs) that computes cut c, if any
+static bool _MatchCut(const Cut &c, Match *m) {
+  for (unsigned int i = 0; i < c.n_leaves; i++) {
+    if (_Ignores(c.tt, i)) {
+      return false; // a smaller cut does the same
+    }
+  }
+  unsigned int rows = 1 << c.n_leaves;
+  unsigned int tt = c.tt & ((1 << rows) - 1);
+  unsigned int ones = __builtin_popcount(tt);
+  unsigned int row = 0; // the row that differs, for AND and OR
+  if (ones == 1) {
+    row = __builtin_ctz(tt);
+  } else if (ones == rows - 1) {
+    row = __builtin_ctz(~tt);
+  }
+  m->leaf.assign(c.leaf, c.leaf + c.n_leaves);
+  m->inverted.assign(c.n_leaves, false);
+  if ((ones == 1) || (ones == rows - 1)) {
+    // true on one row: AND of the literals of that row. false on one
+    // row: OR of the literals that are false on it
+    m->op = (ones == 1) ? ((rows == 8) ? GateEnum::AND3 : GateEnum::AND)
+                        : ((rows == 8) ? GateEnum::OR3 : GateEnum::OR);
+    for (unsigned int i = 0; i < c.n_leaves; i++) {
+      m->inverted[i] = (((row >> i) & 1) == 0) == (ones == 1);
+    }
+    return true;
+  }
+  if (rows == 4) {
+    if ((tt == 0x6) || (tt == 0x9)) { // XOR or XNOR
+      m->op = GateEnum::XOR;
+      m->inverted[0] = (tt == 0x9);
+      return true;
+    }
+    return false;
+  }
+  // MAJORITY is self dual, so inverted inputs cover an inverted output
+  for (unsigned int flip = 0; flip < 8; flip++) {
+    uint8_t maj = 0;
+    for (unsigned int r = 0; r < 8; r++) {
+      maj |= (__builtin_popcount(r ^ flip) > 1) << r;
+    }
+    if (maj == c.tt) {
+      m->op = GateEnum::MAJORITY;
+      for (unsigned int i = 0; i < 3; i++) {
+        m->inverted[i] = (flip >> i) & 1;
+      }
+      return true;
+    }
+  }
+  return false;
+}
+
+std::shared_ptr<CompiledCircuit> TechMap(const CompiledCircuit &ckt) {
+  auto t_map = std::chrono::steady_clock::now();
+  const size_t n_wires = ckt.numberWires();
+  const WireId NONE = WireId(-1);
+
+  // a NOT only flips its input, so every wire is a literal of a base
+  // wire driven by an input or by a gate that is not a NOT
+  std::vector<WireId> base(n_wires);
+  std::vector<bool> inv(n_wires, false);
+  std::vector<GateId> driver(n_wires, NONE);
+  for (WireId w = 0; w < n_wires; w++) {
+    base[w] = w;
+  }
+  for (const auto &g : ckt.allGates) {
+    if (g.op == GateEnum::NOT) {
+      WireId o = g.outWires[0];
+      base[o] = base[g.inWires[0]];
+      inv[o] = !inv[g.inWires[0]];
+    } else {
+      for (auto o : g.outWires) {
+        driver[o] = g.id;
+      }
+    }
+  }
+  // readers of each base wire, not counting NOTs
+  std::vector<unsigned int> refs(n_wires, 0);
+  for (const auto &g : ckt.allGates) {
+    if (g.op != GateEnum::NOT) {
+      for (auto iw : g.inWires) {
+        refs[base[iw]]++;
+      }
+    }
+  }
+
+  // enumerate the cuts of every base wire in program order, and pick the
+  // match of least area flow (ties to the least depth) as we go
+  std::vector<std::vector<Cut>> cuts(n_wires);
+  std::vector<Match> best(n_wires);
+  std::vector<double> flow(n_wires, 0.0);
+  std::vector<unsigned int> depth(n_wires, 0);
+  auto trivial = [](WireId w) { return Cut{1, {w, 0, 0}, LEAF_TT[0]}; };
+  for (const auto &g : ckt.inputGates) {
+    for (auto o : g.outWires) {
+      cuts[o].push_back(trivial(o));
+    }
+  }
+  for (const auto &g : ckt.allGates) {
+    if ((g.op == GateEnum::NOT) || (g.op == GateEnum::OUTPUT)) {
+      continue;
+    }
+    for (auto o : g.outWires) {
+      cuts[o].push_back(trivial(o));
+    }
+    WireId n = g.outWires[0];
+    // the gate itself is always a match
+    Match &m = best[n];
+    m.op = g.op;
+    for (auto iw : g.inWires) {
+      m.leaf.push_back(base[iw]);
+      m.inverted.push_back(inv[iw]);
+    }
+    bool inverse = (g.op == GateEnum::NAND) || (g.op == GateEnum::NOR) ||
+                   (g.op == GateEnum::XNOR);
+    bool two_input = (g.outWires.size() == 1) && (g.inWires.size() == 2) &&
+                     (inverse || (g.op == GateEnum::AND) ||
+                      (g.op == GateEnum::OR) || (g.op == GateEnum::XOR));
+    std::vector<Match> matches(1, m);
+    if (two_input) {
+      WireId a = base[g.inWires[0]], b = base[g.inWires[1]];
+      uint8_t flip_a = inv[g.inWires[0]] ? 0xff : 0;
+      uint8_t flip_b = inv[g.inWires[1]] ? 0xff : 0;
+      for (const auto &ca : cuts[a]) {
+        for (const auto &cb : cuts[b]) {
+          if (cuts[n].size() >= MAX_CUTS) {
+            break;
+          }
+          // merge the leaves, at most three
+          WireId merged[6];
+          unsigned int n_merged =
+              std::set_union(ca.leaf, ca.leaf + ca.n_leaves, cb.leaf,
+                             cb.leaf + cb.n_leaves, merged) -
+              merged;
+          if ((n_merged < 2) || (n_merged > 3)) {
+            continue;
+          }
+          Cut u;
+          u.n_leaves = n_merged;
+          std::copy(merged, merged + n_merged, u.leaf);
+          uint8_t ta = _Expand(ca, u) ^ flip_a;
+          uint8_t tb = _Expand(cb, u) ^ flip_b;
+          bool is_and = (g.op == GateEnum::AND) || (g.op == GateEnum::NAND);
+          bool is_or = (g.op == GateEnum::OR) || (g.op == GateEnum::NOR);
+          u.tt = is_and ? (ta & tb) : is_or ? (ta | tb) : (ta ^ tb);
+          u.tt ^= inverse ? 0xff : 0;
+          bool seen = false;
+          for (const auto &c : cuts[n]) {
+            seen = seen || ((c.n_leaves == u.n_leaves) &&
+                            std::equal(c.leaf, c.leaf + c.n_leaves, u.leaf));
+          }
+          if (seen) {
+            continue;
+          }
+          // keep cuts that match no gate too, a larger cut may
+          Match cm;
+          cuts[n].push_back(u);
+          if (_MatchCut(u, &cm)) {
+            matches.push_back(cm);
+          }
+        }
+      }
+    }
+    flow[n] = -1.0;
+    for (const auto &cm : matches) {
+      double f = GateBootstraps(cm.op);
+      unsigned int d = 0;
+      for (auto l : cm.leaf) {
+        f += flow[l] / std::max(refs[l], 1u);
+        d = std::max(d, depth[l]);
+      }
+      d += GateBootstraps(cm.op);
+      if ((flow[n] < 0.0) || (f < flow[n] - 1e-9) ||
+          ((f < flow[n] + 1e-9) && (d < depth[n]))) {
+        flow[n] = f;
+        depth[n] = d;
+        best[n] = cm;
+      }
+    }
+  }
+
+  // keep the matches the outputs need, walking back from them
+  std::vector<bool> needed(n_wires, false);
+  for (auto gid : ckt.outputGates) {
+    needed[base[ckt.allGates[gid].inWires[0]]] = true;
+  }
+  for (auto g = ckt.allGates.rbegin(); g != ckt.allGates.rend(); ++g) {
+    if ((g->op == GateEnum::NOT) || (g->op == GateEnum::OUTPUT) ||
+        !needed[g->outWires[0]]) {
+      continue;
+    }
+    for (auto l : best[g->outWires[0]].leaf) {
+      needed[l] = true;
+    }
+  }
+
+  // and write the mapped circuit. wire ids are kept, inverted leaves
+  // reuse an existing NOT of the wire if there is one
+  auto c = std::make_shared<CompiledCircuit>();
+  c->keepNames = ckt.keepNames;
+  for (WireId w = 0; w < n_wires; w++) {
+    c->addWire(ckt.keepNames ? ckt.wireNames[w] : "");
+  }
+  std::vector<WireId> notWire(n_wires, NONE);
+  for (WireId w = 0; w < n_wires; w++) {
+    if (inv[w] && (notWire[base[w]] == NONE)) {
+      notWire[base[w]] = w;
+    }
+  }
+  std::vector<bool> notDriven(n_wires, false);
+  auto literal = [&](WireId b, bool inverted) {
+    if (!inverted) {
+      return b;
+    }
+    if (notWire[b] == NONE) {
+      notWire[b] = c->addWire(c->keepNames ? "~" + ckt.wireName(b) : "");
+      notDriven.push_back(false);
+    }
+    WireId w = notWire[b];
+    if (!notDriven[w]) {
+      Gate g;
+      g.op = GateEnum::NOT;
+      g.inWires.push_back(b);
+      g.outWires.push_back(w);
+      c->addGate(std::move(g));
+      notDriven[w] = true;
+    }
+    return w;
+  };
+  for (const auto &g : ckt.inputGates) {
+    c->addGate(g);
+  }
+  unsigned int n_before = 0, n_after = 0, n_and3 = 0, n_or3 = 0, n_maj = 0;
+  for (const auto &g : ckt.allGates) {
+    n_before += GateBootstraps(g.op);
+    if (g.op == GateEnum::OUTPUT) {
+      Gate o = g;
+      o.inWires[0] = literal(base[g.inWires[0]], inv[g.inWires[0]]);
+      c->addGate(std::move(o));
+      continue;
+    }
+    if ((g.op == GateEnum::NOT) || !needed[g.outWires[0]]) {
+      continue;
+    }
+    const Match &m = best[g.outWires[0]];
+    Gate mg;
+    mg.op = m.op;
+    mg.ioBus = g.ioBus;
+    mg.ioBit = g.ioBit;
+    for (size_t ix = 0; ix < m.leaf.size(); ix++) {
+      mg.inWires.push_back(literal(m.leaf[ix], m.inverted[ix]));
+    }
+    mg.outWires = g.outWires;
+    n_after += GateBootstraps(mg.op);
+    n_and3 += (mg.op == GateEnum::AND3);
+    n_or3 += (mg.op == GateEnum::OR3);
+    n_maj += (mg.op == GateEnum::MAJORITY);
+    c->addGate(std::move(mg));
+  }
+  c->setOutputBits(ckt.n_output_bits);
+  c->copyPassFlags(ckt);
+  // the NOTs added for inverted leaves still have to be pushed
+  c->inversionsPushed = false;
+  c->techMapped = true;
+  c->finalize();
+  std::cout << "### Tech map " << n_before << " to " << n_after
+            << " bootstraps, " << n_and3 << " AND3 " << n_or3 << " OR3 "
+            << n_maj << " MAJORITY, critical path " << ckt.criticalPath
+            << " to " << c->criticalPath << ", "
+            << std::chrono::duration_cast<std::chrono::milliseconds>(
+                   std::chrono::steady_clock::now() - t_map)
+                   .count()
+            << " msec" << std::endl;
+  return c;
+}
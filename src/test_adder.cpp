@@ -80,7 +80,7 @@
 //
 
 bool test_adder(std::string inFname, unsigned int numTestLoops,
-                lbcrypto::BINFHE_PARAMSET set, lbcrypto::BINFHE_METHOD method) {
+                KeySetPtr keys, const CircuitOptions &opts) {
   // BLU_test_adder: tests BLU with adder programs
   std::cout << "test_adder: Opening file " << inFname
             << " for test_adder parameters" << std::endl;
@@ -152,7 +152,8 @@ bool test_adder(std::string inFname, unsigned int numTestLoops,
     exit(-1);
   }
 
-  Circuit circ(set, method);
+  Circuit circ(keys);
+  circ.setOptions(opts);
   bool success = circ.ReadFile(inFname);
   if (!success) {
     std::cerr << "error parsing file " << inFname << std::endl;
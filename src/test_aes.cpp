@@ -85,7 +85,7 @@
 // generalize input output: in1 in2 should become one 2d vector. #shoudl be 0, 1
 
 bool test_aes(std::string inFname, unsigned int numTestLoops,
-              lbcrypto::BINFHE_PARAMSET set, lbcrypto::BINFHE_METHOD method) {
+              KeySetPtr keys, const CircuitOptions &opts) {
   // BLU_test_aes: tests BLU with aes programs
   std::cout << "test_aes: Opening file " << inFname
             << " for test_aes parameters" << std::endl;
@@ -157,7 +157,8 @@ bool test_aes(std::string inFname, unsigned int numTestLoops,
     exit(-1);
   }
 
-  Circuit circ(set, method);
+  Circuit circ(keys);
+  circ.setOptions(opts);
   bool success = circ.ReadFile(inFname);
   if (!success) {
     std::cerr << "error parsing file " << inFname << std::endl;
@@ -37,11 +37,12 @@
 #define TEST_AES_H
 
 #include "binfhecontext.h"
+#include "circuit.h"
 #include <string>
 #include <vector>
 
 // function declaration
 bool test_aes(std::string outputFname, unsigned int num_test_loops,
-              lbcrypto::BINFHE_PARAMSET set, lbcrypto::BINFHE_METHOD method);
+              KeySetPtr keys, const CircuitOptions &opts);
 
 #endif
@@ -40,10 +40,10 @@
 #include <vector>
 
 #include "binfhecontext.h"
+#include "circuit.h"
 
 // function declaration
 bool test_comparator(std::string outputFname, unsigned int num_test_loops,
-                     lbcrypto::BINFHE_PARAMSET set,
-                     lbcrypto::BINFHE_METHOD method);
+                     KeySetPtr keys, const CircuitOptions &opts);
 
 #endif // SRC_TEST_COMPARATOR_H_
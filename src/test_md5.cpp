@@ -86,7 +86,7 @@
 //
 
 bool test_md5(std::string inFname, unsigned int numTestLoops,
-              lbcrypto::BINFHE_PARAMSET set, lbcrypto::BINFHE_METHOD method) {
+              KeySetPtr keys, const CircuitOptions &opts) {
 
   std::cout << "test_md5: Opening file " << inFname
             << " for test_md5 parameters" << std::endl;
@@ -165,7 +165,8 @@ bool test_md5(std::string inFname, unsigned int numTestLoops,
     exit(-1);
   }
 
-  Circuit circ(set, method);
+  Circuit circ(keys);
+  circ.setOptions(opts);
   bool success = circ.ReadFile(inFname);
   if (!success) {
     std::cout << "error parsing file " << inFname << std::endl;
@@ -82,8 +82,7 @@
 //
 
 bool test_multiplier(std::string inFname, unsigned int numTestLoops,
-                     lbcrypto::BINFHE_PARAMSET set,
-                     lbcrypto::BINFHE_METHOD method) {
+                     KeySetPtr keys, const CircuitOptions &opts) {
   // BLU_test_multiplier: tests BLU with multiplier programs
   std::cout << "Opening file " << inFname << " for test_multiplier parameters"
             << std::endl;
@@ -155,7 +154,8 @@ bool test_multiplier(std::string inFname, unsigned int numTestLoops,
     exit(-1);
   }
 
-  Circuit circ(set, method);
+  Circuit circ(keys);
+  circ.setOptions(opts);
   bool success = circ.ReadFile(inFname);
   if (!success) {
     std::cerr << "error parsing file " << inFname << std::endl;
@@ -37,12 +37,12 @@
 #define TEST_MULTIPLIER_H
 
 #include "binfhecontext.h"
+#include "circuit.h"
 #include <string>
 #include <vector>
 
 // function declaration
 bool test_multiplier(std::string outputFname, unsigned int num_test_loops,
-                     lbcrypto::BINFHE_PARAMSET set,
-                     lbcrypto::BINFHE_METHOD method);
+                     KeySetPtr keys, const CircuitOptions &opts);
 
 #endif
@@ -79,8 +79,7 @@
 //
 
 bool test_parity(std::string inFname, unsigned int numTestLoops,
-                 lbcrypto::BINFHE_PARAMSET set,
-                 lbcrypto::BINFHE_METHOD method) {
+                 KeySetPtr keys, const CircuitOptions &opts) {
   // BLU_test_parity: tests BLU with parity programs
   std::cout << "test_parity: Opening file " << inFname
             << " for test_parity parameters" << std::endl;
@@ -149,7 +148,8 @@ bool test_parity(std::string inFname, unsigned int numTestLoops,
     exit(-1);
   }
 
-  Circuit circ(set, method);
+  Circuit circ(keys);
+  circ.setOptions(opts);
   bool success = circ.ReadFile(inFname);
   if (!success) {
     std::cout << "error parsing file " << inFname << std::endl;
@@ -86,8 +86,7 @@
 //
 
 bool test_sha256(std::string inFname, unsigned int numTestLoops,
-                 lbcrypto::BINFHE_PARAMSET set,
-                 lbcrypto::BINFHE_METHOD method) {
+                 KeySetPtr keys, const CircuitOptions &opts) {
 
   std::cout << "test_sha256: Opening file " << inFname
             << " for test_sha256 parameters" << std::endl;
@@ -166,7 +165,8 @@ bool test_sha256(std::string inFname, unsigned int numTestLoops,
     exit(-1);
   }
 
-  Circuit circ(set, method);
+  Circuit circ(keys);
+  circ.setOptions(opts);
   bool success = circ.ReadFile(inFname);
   if (!success) {
     std::cout << "error parsing file " << inFname << std::endl;
@@ -37,11 +37,12 @@
 #define TEST_SHA256_H
 
 #include "binfhecontext.h"
+#include "circuit.h"
 #include <string>
 #include <vector>
 
 // function declaration
 bool test_sha256(std::string outputFname, unsigned int num_test_loops,
-                 lbcrypto::BINFHE_PARAMSET set, lbcrypto::BINFHE_METHOD method);
+                 KeySetPtr keys, const CircuitOptions &opts);
 
 #endif
@@ -120,10 +120,10 @@ std::string UintVec2str(std::vector<unsigned int> in) {
 }
 
 void parse_inputs(int argc, char **argv, bool *assemble_flag,
-                  bool *gen_fan_flag, bool *analyze_flag, bool *verbose,
+                  bool *analyze_flag, bool *verbose,
                   lbcrypto::BINFHE_PARAMSET *set,
                   lbcrypto::BINFHE_METHOD *method, unsigned int *n_cases,
-                  unsigned int *num_test_loops) {
+                  unsigned int *num_test_loops, CircuitOptions *opts) {
   // manage the command line args
   int opt; // option from command line parsing
 
@@ -133,19 +133,34 @@ void parse_inputs(int argc, char **argv, bool *assemble_flag,
           " demo with settings (default value show in parenthesis):\n") +
       std::string("-a assemble flag (false) note, if true then analyze must be "
                   "true\n") +
-      std::string("-f fanout generation flag (false)\n") +
       std::string("-z analyze flag (false)\n") +
       std::string("-c # test cases (not used in all TB programs\n") +
       std::string("-n # test loops [10]\n") +
-      std::string("-s parameter set (TOY|STD128Q_LMKCDEY) [STD128Q_LMKCDEY]\n") +
+      std::string("-s parameter set "
+                  "(TOY|STD128|STD128Q_LMKCDEY|STD128Q_3_LMKCDEY) "
+                  "[STD128Q_LMKCDEY]\n") +
       std::string("-m method (AP|GINX|LMKCDEY) [LMKCDEY] \n") +
       std::string("-v verbose flag (false)\n") +
+      std::string("-d dataflow execution, no barrier between levels (false)\n") +
+      std::string("-q FIFO ready queue, not critical path first (false)\n") +
+      std::string("-k key store directory, reuse saved keys (none)\n") +
+      std::string("-l cap on live ciphertexts, memory bounded schedule "
+                  "(none)\n") +
+      std::string("-t map onto 3 input gates (AND3, OR3, MAJORITY), needs "
+                  "STD128Q_3_LMKCDEY (false)\n") +
+      std::string("-i fold NOT gates into neighbouring gates (false)\n") +
+      std::string("-o optimize: fold constants, merge equal gates, drop dead "
+                  "gates (false)\n") +
+      std::string("-b rebalance AND and XOR chains to shorten the critical "
+                  "path (false)\n") +
+      std::string("-u map onto LUT gates of 3 or 4 inputs, one functional "
+                  "bootstrap each, uses STD128 (or TOY) and GINX (none)\n") +
       std::string("\nh prints this message\n");
 
   int num_test_loops_in;
   int n_cases_in;
 
-  while ((opt = getopt(argc, argv, "azfc:s:m:n:vh")) != -1) {
+  while ((opt = getopt(argc, argv, "azc:s:m:n:vdqk:l:tiobu:h")) != -1) {
     std::string set_str;
     std::string method_str;
 
@@ -154,19 +169,21 @@ void parse_inputs(int argc, char **argv, bool *assemble_flag,
       *assemble_flag = true;
       std::cout << "assembling" << std::endl;
       break;
-    case 'f':
-      *gen_fan_flag = true;
-      std::cout << "fan_flag true" << std::endl;
-      break;
     case 'z':
       *analyze_flag = true;
       std::cout << "analyzing" << std::endl;
       break;
     case 's':
       set_str = optarg;
-      if (set_str == "STD128Q_LMKCDEY") {
+      if (set_str == "STD128") {
+        *set = lbcrypto::STD128;
+        std::cout << "using STD128" << std::endl;
+      } else if (set_str == "STD128Q_LMKCDEY") {
         *set = lbcrypto::STD128Q_LMKCDEY;
         std::cout << "using STD128Q_LMKCDEY" << std::endl;
+      } else if (set_str == "STD128Q_3_LMKCDEY") {
+        *set = lbcrypto::STD128Q_3_LMKCDEY;
+        std::cout << "using STD128Q_3_LMKCDEY" << std::endl;
       } else if (set_str == "TOY") {
         *set = lbcrypto::TOY;
         std::cout << "using TOY" << std::endl;
@@ -213,6 +230,46 @@ void parse_inputs(int argc, char **argv, bool *assemble_flag,
       *verbose = true;
       std::cout << "verbose" << std::endl;
       break;
+    case 'd':
+      opts->dataflow = true;
+      std::cout << "dataflow execution" << std::endl;
+      break;
+    case 'q':
+      opts->fifo = true;
+      std::cout << "FIFO ready queue" << std::endl;
+      break;
+    case 'k':
+      opts->keyDir = optarg;
+      std::cout << "key store " << opts->keyDir << std::endl;
+      break;
+    case 'l':
+      opts->maxLive = strtoull(optarg, nullptr, 10);
+      std::cout << "live ciphertext cap " << opts->maxLive << std::endl;
+      break;
+    case 't':
+      opts->techMap = true;
+      std::cout << "tech map onto 3 input gates" << std::endl;
+      break;
+    case 'i':
+      opts->pushNots = true;
+      std::cout << "fold NOT gates into neighbouring gates" << std::endl;
+      break;
+    case 'o':
+      opts->optimize = true;
+      std::cout << "optimize circuits" << std::endl;
+      break;
+    case 'b':
+      opts->rebalance = true;
+      std::cout << "rebalance circuits" << std::endl;
+      break;
+    case 'u':
+      opts->lutInputs = atoi(optarg);
+      if ((opts->lutInputs != 3) && (opts->lutInputs != 4)) {
+        std::cerr << "Error LUT gates have 3 or 4 inputs" << std::endl;
+        exit(-1);
+      }
+      std::cout << "map onto LUT" << opts->lutInputs << " gates" << std::endl;
+      break;
     case 'h':
     default: /* '?' */
       std::cout << usage_string << std::endl;
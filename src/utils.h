@@ -42,6 +42,7 @@
 #include <vector>
 
 #include "binfhecontext.h"
+#include "circuit.h"
 
 /**
  * Helper function to insure files exists
@@ -75,9 +76,9 @@ std::vector<unsigned int> BinStr2UintVec(std::string inbin);
 std::string UintVec2str(std::vector<unsigned int> in);
 
 void parse_inputs(int argc, char **argv, bool *assemble_flag,
-                  bool *gen_fan_flag, bool *analyze_flag, bool *verbose,
+                  bool *analyze_flag, bool *verbose,
                   lbcrypto::BINFHE_PARAMSET *set,
                   lbcrypto::BINFHE_METHOD *method, unsigned int *n_cases,
-                  unsigned int *num_test_loops);
+                  unsigned int *num_test_loops, CircuitOptions *opts);
 
 #endif // SRC_UTILS_H_
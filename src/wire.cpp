@@ -37,29 +37,11 @@
 
 #include <iostream>
 
-Wire::Wire(){};
+Wire::Wire() : id(0), value(false){};
 Wire::~Wire(){};
-void Wire::setName(std::string n) { this->name = n; }
-std::string Wire::getName(void) { return this->name; }
+void Wire::setId(WireId n) { this->id = n; }
+WireId Wire::getId(void) const { return this->id; }
 void Wire::setValue(bool b) { this->value = b; }
-bool Wire::getValue(void) { return this->value; }
+bool Wire::getValue(void) const { return this->value; }
 void Wire::setCipherText(CipherText ct) { this->ct = ct; }
-CipherText Wire::getCipherText(void) { return this->ct; }
-void Wire::setFanoutGates(NameList f) { this->fanoutGates = f; }
-NameList Wire::getFanoutGates(void) { return this->fanoutGates; }
-unsigned int Wire::getNumberFanoutGates(void) {
-  return this->fanoutGates.size();
-}
-
-void Wire::updateFanoutGates(std::string gateToRemove) {
-  auto w = std::find(this->fanoutGates.begin(), this->fanoutGates.end(),
-                     gateToRemove);
-
-  if (w != this->fanoutGates.end()) {
-    this->fanoutGates.erase(w);
-    // remove w
-  } else {
-    std::cout << "error, trying to remove node " << gateToRemove
-              << " from fanoutGates and it isn;t there" << std::endl;
-  }
-}
+CipherText Wire::getCipherText(void) const { return this->ct; }
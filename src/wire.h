@@ -37,38 +37,39 @@
 #define WIRE_H
 #include "binfhecontext.h"
 #include <algorithm>
+#include <cstdint>
 #include <deque>
 #include <string>
 #include <vector>
 
-using NameList = std::vector<std::string>;
+// wires and gates are identified by dense integer ids that index the
+// circuit's wire and gate arrays. names only exist in an optional side
+// table used for debugging.
+using WireId = uint32_t;
+using GateId = uint32_t;
+using WireIdList = std::vector<WireId>;
+using GateIdList = std::vector<GateId>;
 using CipherText = lbcrypto::LWECiphertext;
 
 class Wire {
 public:
   Wire();
   ~Wire();
-  void setName(std::string n);
-  std::string getName(void);
+  void setId(WireId n);
+  WireId getId(void) const;
   void setValue(bool b);
-  bool getValue(void);
-  void setFanoutGates(NameList f);
-  NameList getFanoutGates(void);
-  unsigned int getNumberFanoutGates(void);
+  bool getValue(void) const;
   void setCipherText(CipherText ct);
-  CipherText getCipherText(void);
-
-  void updateFanoutGates(std::string gateToRemove);
+  CipherText getCipherText(void) const;
 
 private:
-  std::string name;     // note can be an integer
-  NameList fanoutGates; // list of gates this wire fans out to
+  WireId id; // index of this wire in the circuit, the fanout gates of
+             // the wire are kept in the circuit netlist
   bool value;
   CipherText ct; // used for encrypted value
 };
 
 using WireList = std::vector<Wire>;
-using WireNameList = std::vector<std::string>;
-using WireQueue = std::deque<Wire>;
+using WireQueue = std::deque<WireId>;
 
 #endif